@@ -0,0 +1,306 @@
+// Native benchmark of the OBJ loaders on generated OBJ/MTL files, printed as JSON so runs
+// can be compared over time.
+//   g++ -O2 -std=c++17 -pthread -I.. loaderBench.cpp -o loaderBench
+//   ./loaderBench [--max-triangles N] [--runs N] [--dir path] > loaderBench.json
+// Shapes are a wavy grid, a UV sphere and a soup of unconnected random triangles, from 1K
+// triangles up to --max-triangles (default 1M, 10M at most), with and without vt/vn,
+// as triangles or quads and with one or many materials. Files are written to --dir and
+// removed again after their case. loadObjMtl runs at 1, 2, 4 and 8 threads and reports its
+// phase times, which shows the stages that scale: counting, slice parsing, normal generation,
+// the weld and the interleave run on every thread, the event merge and grouping on one.
+#define WGL_LOAD_STATS 1
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "objStream.h"
+
+// Every heap allocation of the process goes through these, so a loader's allocation count
+// is the difference around its call.
+static std::atomic<size_t> allocCount{0}, allocBytes{0};
+
+static void* countedAlloc(size_t size, size_t align) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (align <= alignof(std::max_align_t)) p = malloc(size ? size : 1);
+    else if (posix_memalign(&p, align, size ? size : 1) != 0) p = nullptr;
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return countedAlloc(size, 0); }
+void* operator new[](size_t size) { return countedAlloc(size, 0); }
+void* operator new(size_t size, std::align_val_t align) { return countedAlloc(size, (size_t)align); }
+void* operator new[](size_t size, std::align_val_t align) { return countedAlloc(size, (size_t)align); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Peak RSS since the last reset. Linux can reset the high-water mark through clear_refs;
+// elsewhere this is the peak of the whole process.
+static void resetPeakRss() {
+#ifdef __linux__
+    if (FILE* f = fopen("/proc/self/clear_refs", "w")) { fputs("5", f); fclose(f); }
+#endif
+}
+
+static long peakRssKb() {
+#ifdef __linux__
+    if (FILE* f = fopen("/proc/self/status", "r")) {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), f))
+            if (strncmp(line, "VmHWM:", 6) == 0) kb = atol(line + 6);
+        fclose(f);
+        if (kb >= 0) return kb;
+    }
+#endif
+    rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    return u.ru_maxrss;
+}
+
+enum class Shape { Grid, Sphere, Soup };
+
+struct Case {
+    const char* name;
+    Shape shape;
+    bool uv, normals, quads;
+    int materials;
+};
+
+const Case kCases[] = {
+    {"grid_p",        Shape::Grid,   false, false, false, 1},
+    {"grid_pun",      Shape::Grid,   true,  true,  false, 1},
+    {"grid_pun_quad", Shape::Grid,   true,  true,  true,  1},
+    {"grid_pun_mat",  Shape::Grid,   true,  true,  false, 64},
+    {"sphere_pn_quad", Shape::Sphere, false, true,  true,  1},
+    {"soup_pun",      Shape::Soup,   true,  true,  false, 1},
+};
+
+// Writes about `triangles` triangles of `c` to objPath and its materials, if any, to mtlName
+// next to it. Grids and spheres share their vertices between cells like an exporter would;
+// the soup gives every triangle its own three. Returns the triangle count written.
+static size_t writeObj(const Case& c, size_t triangles, const std::string& dir, const std::string& objPath, const std::string& mtlName) {
+    FILE* f = fopen(objPath.c_str(), "wb");
+    if (!f) return 0;
+    std::vector<char> buffer(1 << 20);
+    setvbuf(f, buffer.data(), _IOFBF, buffer.size());
+    if (c.materials > 1) {
+        FILE* m = fopen((dir + "/" + mtlName).c_str(), "wb");
+        for (int i = 0; m && i < c.materials; ++i)
+            fprintf(m, "newmtl m%d\nKd %.3f %.3f %.3f\n\n", i, (i % 4) / 3.0, (i / 4 % 4) / 3.0, (i / 16 % 4) / 3.0);
+        if (m) fclose(m);
+        fprintf(f, "mtllib %s\n", mtlName.c_str());
+    }
+
+    size_t written = 0;
+    if (c.shape == Shape::Soup) {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> u(-1, 1);
+        for (size_t t = 0; t < triangles; ++t) {
+            float cx = u(rng) * 10, cy = u(rng) * 10, cz = u(rng) * 10;
+            for (int k = 0; k < 3; ++k) fprintf(f, "v %.6f %.6f %.6f\n", cx + u(rng), cy + u(rng), cz + u(rng));
+            if (c.uv) for (int k = 0; k < 3; ++k) fprintf(f, "vt %.6f %.6f\n", u(rng) * 0.5f + 0.5f, u(rng) * 0.5f + 0.5f);
+            if (c.normals) fprintf(f, "vn %.6f %.6f %.6f\n", u(rng), u(rng), u(rng));
+            if (c.materials > 1 && t % 1024 == 0) fprintf(f, "usemtl m%d\n", (int)(t / 1024 % c.materials));
+            if (c.uv && c.normals) fprintf(f, "f -3/-3/-1 -2/-2/-1 -1/-1/-1\n");
+            else if (c.normals) fprintf(f, "f -3//-1 -2//-1 -1//-1\n");
+            else if (c.uv) fprintf(f, "f -3/-3 -2/-2 -1/-1\n");
+            else fprintf(f, "f -3 -2 -1\n");
+        }
+        written = triangles;
+    } else {
+        // an s x s cell grid; the sphere maps it to latitude/longitude
+        size_t s = std::max<size_t>(1, (size_t)std::sqrt(triangles / 2.0));
+        const float pi = 3.14159265f;
+        for (size_t y = 0; y <= s; ++y)
+            for (size_t x = 0; x <= s; ++x) {
+                float u = (float)x / s, v = (float)y / s, p[3], n[3];
+                if (c.shape == Shape::Grid) {
+                    p[0] = u; p[1] = v; p[2] = 0.05f * std::sin(u * 20) * std::cos(v * 20);
+                    n[0] = -p[2]; n[1] = 0; n[2] = 1;
+                } else {
+                    float lon = u * 2 * pi, lat = v * pi;
+                    n[0] = std::sin(lat) * std::cos(lon); n[1] = std::cos(lat); n[2] = std::sin(lat) * std::sin(lon);
+                    p[0] = n[0]; p[1] = n[1]; p[2] = n[2];
+                }
+                fprintf(f, "v %.6f %.6f %.6f\n", p[0], p[1], p[2]);
+                if (c.uv) fprintf(f, "vt %.6f %.6f\n", u, v);
+                if (c.normals) fprintf(f, "vn %.6f %.6f %.6f\n", n[0], n[1], n[2]);
+            }
+        auto corner = [&](size_t i) {
+            if (c.uv && c.normals) fprintf(f, " %zu/%zu/%zu", i, i, i);
+            else if (c.normals) fprintf(f, " %zu//%zu", i, i);
+            else if (c.uv) fprintf(f, " %zu/%zu", i, i);
+            else fprintf(f, " %zu", i);
+        };
+        size_t band = std::max<size_t>(1, s / c.materials);
+        for (size_t y = 0; y < s; ++y) {
+            if (c.materials > 1 && y % band == 0) fprintf(f, "usemtl m%d\n", (int)(y / band % c.materials));
+            for (size_t x = 0; x < s; ++x) {
+                size_t a = y*(s+1) + x + 1, b = a + 1, d = a + s + 1, e = d + 1;
+                if (c.quads) {
+                    fputc('f', f); corner(a); corner(b); corner(e); corner(d); fputc('\n', f);
+                } else {
+                    fputc('f', f); corner(a); corner(b); corner(e); fputc('\n', f);
+                    fputc('f', f); corner(a); corner(e); corner(d); fputc('\n', f);
+                }
+            }
+        }
+        written = s * s * 2;
+    }
+    fclose(f);
+    return written;
+}
+
+// The position-only istringstream loader the repo used to ship as loadObjSimple, as a
+// baseline. Like it, it only triangulates triangles and quads.
+static size_t loadIstringstream(const std::string& path) {
+    std::vector<float> positions;
+    std::vector<unsigned int> indices;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string prefix;
+        iss >> prefix;
+        if (prefix == "v") {
+            float x, y, z;
+            iss >> x >> y >> z;
+            positions.insert(positions.end(), {x, y, z});
+        } else if (prefix == "f") {
+            std::string token;
+            std::vector<int> face;
+            while (iss >> token) {
+                int i = std::stoi(token.substr(0, token.find('/')));
+                face.push_back(i < 0 ? (int)(positions.size() / 3) + i : i - 1);
+            }
+            if (face.size() >= 3) indices.insert(indices.end(), {(unsigned)face[0], (unsigned)face[1], (unsigned)face[2]});
+            if (face.size() == 4) indices.insert(indices.end(), {(unsigned)face[0], (unsigned)face[2], (unsigned)face[3]});
+        }
+    }
+    return positions.size() / 3;
+}
+
+struct Loader {
+    std::string name;
+    // returns the vertex count; the loadObjMtl ones add their phase times to `stats`
+    std::function<size_t(const std::string& path, const std::string& dir, LoadStats& stats)> load;
+};
+
+template <class Layout>
+static size_t loadWith(const std::string& path, const std::string& dir, unsigned threads, LoadStats& stats) {
+    MaterialLib materials;
+    ObjLoadOptions opt;
+    opt.threads = threads;
+    opt.stats = &stats;
+    Mesh mesh = loadObjMtl<Layout>(path.c_str(), materials, (dir + "/").c_str(), opt);
+    return mesh.vertices.size() / Layout::kFloats;
+}
+
+// Fed in 64 KB pieces, the way a fetch stream delivers them.
+static size_t loadStreamed(const std::string& path, const std::string& dir) {
+    MappedFile file(path.c_str());
+    MaterialLib materials;
+    ObjStreamParser<> parser(materials, fileResolver(dir + "/"));
+    for (size_t at = 0; at < file.size; at += 64 << 10) parser.feed(file.data + at, std::min<size_t>(64 << 10, file.size - at));
+    return parser.finish().vertices.size() / ObjLayoutPUN::kFloats;
+}
+
+int main(int argc, char** argv) {
+    size_t maxTriangles = 1000000;
+    int runs = 3;
+    std::string dir = "loaderBench.data";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--max-triangles") == 0) maxTriangles = std::min<size_t>(strtoull(argv[i+1], nullptr, 10), 10000000);
+        else if (strcmp(argv[i], "--runs") == 0) runs = std::max(1, atoi(argv[i+1]));
+        else if (strcmp(argv[i], "--dir") == 0) dir = argv[i+1];
+    }
+    std::filesystem::create_directories(dir);
+
+    std::vector<Loader> loaders;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        std::string name = "loadObjMtl/" + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        loaders.push_back({name, [threads](const std::string& p, const std::string& d, LoadStats& s) { return loadWith<ObjLayoutPUN>(p, d, threads, s); }});
+    }
+    loaders.insert(loaders.end(), {
+        {"loadObjMtl<ObjLayoutPN>", [](const std::string& p, const std::string& d, LoadStats& s) { return loadWith<ObjLayoutPN>(p, d, 0, s); }},
+        {"loadObjMtl<ObjLayoutP>",  [](const std::string& p, const std::string& d, LoadStats& s) { return loadWith<ObjLayoutP>(p, d, 0, s); }},
+        {"ObjStreamParser/64 KB",   [](const std::string& p, const std::string& d, LoadStats&) { return loadStreamed(p, d); }},
+        {"istringstream",           [](const std::string& p, const std::string&, LoadStats&) { return loadIstringstream(p); }},
+    });
+
+    printf("{\n  \"benchmark\": \"loaderBench\",\n  \"hardwareThreads\": %u,\n  \"runs\": %d,\n  \"results\": [", std::thread::hardware_concurrency(), runs);
+    bool first = true;
+    for (size_t target = 1000; target <= maxTriangles; target *= 10) {
+        for (const Case& c : kCases) {
+            std::string name = std::string(c.name) + "_" + std::to_string(target);
+            std::string objPath = dir + "/" + name + ".obj", mtlName = std::string(c.name) + ".mtl";
+            size_t triangles = writeObj(c, target, dir, objPath, mtlName);
+            size_t bytes = std::filesystem::file_size(objPath);
+            for (const Loader& l : loaders) {
+                // the baseline is far too slow to be worth waiting for on the largest files
+                if (l.name == "istringstream" && target > 1000000) continue;
+                fprintf(stderr, "%s: %s\n", name.c_str(), l.name.c_str());
+                double best = 1e30;
+                size_t vertices = 0, allocations = 0, allocated = 0;
+                long peakKb = 0;
+                LoadStats phases; // of the fastest run
+                for (int r = 0; r < runs; ++r) {
+                    resetPeakRss();
+                    long before = peakRssKb();
+                    size_t count0 = allocCount, bytes0 = allocBytes;
+                    LoadStats stats;
+                    double t0 = nowMs();
+                    vertices = l.load(objPath, dir, stats);
+                    double ms = nowMs() - t0;
+                    allocations = allocCount - count0;
+                    allocated = allocBytes - bytes0;
+                    peakKb = std::max(peakKb, peakRssKb() - before);
+                    if (ms < best) phases = stats;
+                    best = std::min(best, ms);
+                }
+                printf("%s\n    {\"case\": \"%s\", \"shape\": \"%s\", \"triangles\": %zu, \"bytes\": %zu, \"uv\": %s, \"normals\": %s, \"quads\": %s, \"materials\": %d,\n"
+                       "     \"loader\": \"%s\", \"ms\": %.3f, \"mbPerS\": %.1f, \"trianglesPerS\": %.0f, \"peakRssGrowthKb\": %ld, \"allocations\": %zu, \"allocatedBytes\": %zu, \"vertices\": %zu",
+                       first ? "" : ",", name.c_str(), c.shape == Shape::Grid ? "grid" : c.shape == Shape::Sphere ? "sphere" : "soup", triangles, bytes,
+                       c.uv ? "true" : "false", c.normals ? "true" : "false", c.quads ? "true" : "false", c.materials,
+                       l.name.c_str(), best, bytes / best / 1e3, triangles / best * 1e3, peakKb, allocations, allocated, vertices);
+                if (phases.totalMs > 0)
+                    printf(",\n     \"phasesMs\": {\"map\": %.3f, \"count\": %.3f, \"parse\": %.3f, \"mtl\": %.3f, \"normals\": %.3f, \"weld\": %.3f, \"interleave\": %.3f, \"group\": %.3f}}",
+                           phases.mapMs, phases.countMs, phases.parseMs, phases.mtlMs, phases.normalsMs, phases.weldMs, phases.interleaveMs, phases.groupMs);
+                else
+                    printf("}");
+                first = false;
+                fflush(stdout);
+            }
+            std::filesystem::remove(objPath);
+            std::filesystem::remove(dir + "/" + mtlName);
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
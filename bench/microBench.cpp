@@ -0,0 +1,149 @@
+// Native microbenchmarks for the OBJ loader building blocks.
+//   g++ -O2 -std=c++17 -I.. microBench.cpp -o microBench && ./microBench
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <tuple>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "objScan.h"
+#include "loadObjMtl.h"
+
+// keeps the optimizer from dropping the timed loops
+static volatile double sink;
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<class F> static double timeBest(F f, int runs = 5) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        double t0 = nowMs();
+        f();
+        best = std::min(best, nowMs() - t0);
+    }
+    return best;
+}
+
+static void report(const char* name, double base, double fast, size_t count) {
+    printf("%-28s %9.2f ms  %9.2f ms  %6.1fx  (%.0f M tokens/s)\n", name, base, fast, base / fast, count / fast / 1e3);
+}
+
+static void benchFloats() {
+    const size_t count = 2000000;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-1000.0, 1000.0);
+    std::string text;
+    std::vector<std::string> lines;
+    char tmp[64];
+    for (size_t i = 0; i < count; ++i) {
+        double v = dist(rng);
+        if (i % 7 == 0) snprintf(tmp, sizeof(tmp), "%e ", v * 1e-5);
+        else snprintf(tmp, sizeof(tmp), "%.6f ", v);
+        text += tmp;
+        lines.emplace_back(tmp);
+    }
+
+    // what loadObjMtl did before: one istringstream per line, operator>> per value
+    double base = timeBest([&] {
+        for (const std::string& l : lines) { std::istringstream iss(l); float f; iss >> f; sink = sink + f; }
+    }, 2);
+    double fast = timeBest([&] {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        float f;
+        while (objscan::scanFloat(p, end, f)) sink = sink + f;
+    });
+    report("float: istringstream", base, fast, count);
+
+    double scanf = timeBest([&] {
+        for (const std::string& l : lines) { float f; sscanf(l.c_str(), "%f", &f); sink = sink + f; }
+    }, 2);
+    report("float: sscanf", scanf, fast, count);
+
+    size_t bad = 0;
+    const char* p = text.data();
+    const char* end = p + text.size();
+    for (const std::string& l : lines) {
+        float f = 0;
+        objscan::scanFloat(p, end, f);
+        if (f != strtof(l.c_str(), nullptr)) ++bad;
+    }
+    printf("  %zu of %zu values differ from strtof\n", bad, count);
+}
+
+static void benchCorners() {
+    const size_t count = 3000000;
+    std::mt19937 rng(7);
+    std::string text;
+    std::vector<std::string> tokens;
+    char tmp[64];
+    for (size_t i = 0; i < count; ++i) {
+        int v = (int)(rng() % 2000000) + 1, t = (int)(rng() % 2000000) + 1, n = (int)(rng() % 1000) + 1;
+        snprintf(tmp, sizeof(tmp), "%d/%d/%d", v, t, n);
+        tokens.emplace_back(tmp);
+        text += tmp;
+        text += ' ';
+    }
+
+    double base = timeBest([&] {
+        for (const std::string& s : tokens) { int v = -1, t = -1, n = -1; sscanf(s.c_str(), "%d/%d/%d", &v, &t, &n); sink = sink + v + t + n; }
+    }, 2);
+    double fast = timeBest([&] {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        int v, t, n;
+        while (objscan::scanCorner(p, end, v, t, n)) sink = sink + v + t + n;
+    });
+    report("face corner: sscanf", base, fast, count);
+}
+
+// Corner dedup on a 1000x500 quad grid (1M corners, ~500K unique vertices), in the
+// order a triangulated grid export lists them.
+static void benchDedup() {
+    const int w = 1000, h = 500;
+    std::vector<std::tuple<int,int,int>> corners;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            int a = y*(w+1) + x, b = a + 1, c = a + w + 2, d = a + w + 1;
+            for (int i : {a, b, c, a, c, d}) corners.emplace_back(i, i, (x + y) & 1);
+        }
+    corners.resize(1000000);
+
+    double base = timeBest([&] {
+        std::map<std::tuple<int,int,int>, int> unique;
+        int idx = 0;
+        long long s = 0;
+        for (auto& t : corners) {
+            if (unique.count(t) == 0) unique[t] = idx++;
+            s += unique[t];
+        }
+        sink = sink + s;
+    }, 2);
+    double fast = timeBest([&] {
+        CornerTable unique(corners.size());
+        int idx = 0;
+        long long s = 0;
+        for (auto [v, t, n] : corners) {
+            int id = unique.findOrInsert(v, t, n, idx);
+            if (id == idx) ++idx;
+            s += id;
+        }
+        sink = sink + s;
+    });
+    report("dedup: std::map", base, fast, corners.size());
+}
+
+int main() {
+    printf("%-28s %12s %12s %7s\n", "", "baseline", "new", "speedup");
+    benchFloats();
+    benchCorners();
+    benchDedup();
+    return 0;
+}
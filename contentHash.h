@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fast non-cryptographic 64-bit hash for cache keys. Eight bytes per step, read
+// little-endian, so native tools and the wasm build agree on the value.
+inline uint64_t contentHash(const void* data, size_t size, uint64_t seed = 0x243F6A8885A308D3ull) {
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (size * k);
+    auto mix = [&](uint64_t w) {
+        h = (h ^ (w * k)) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+    };
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t w = 0;
+        for (int i = 0; i < 8; ++i) w |= (uint64_t)p[i] << (8*i);
+        mix(w);
+    }
+    uint64_t tail = 0;
+    for (size_t i = 0; i < size; ++i) tail |= (uint64_t)p[i] << (8*i);
+    mix(tail);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "mappedFile.h"
+
+// Bytes of a file an asset refers to by name (mtllib, map_Kd). `owner` keeps them alive
+// when the resolver produced them; it is empty when the caller owns the bytes. `path` is
+// where the resolver found them, which tells apart the same name in different folders.
+struct ResolvedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<const void> owner;
+    std::string path;
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// Maps a name as written in an OBJ or MTL to its bytes; an empty result means not found.
+using FileResolver = std::function<ResolvedFile(std::string_view name)>;
+
+// Maps `baseDir` + name.
+inline FileResolver fileResolver(std::string baseDir) {
+    return [baseDir = std::move(baseDir)](std::string_view name) {
+        std::string path = baseDir + std::string(name);
+        auto file = std::make_shared<MappedFile>(path.c_str());
+        if (!*file) return ResolvedFile();
+        return ResolvedFile{file->data, file->size, file, std::move(path)};
+    };
+}
+
+// Looks names up in `files` without copying, for fetch results and data embedded in the
+// binary; the caller keeps the bytes alive while they are used.
+inline FileResolver memoryResolver(std::unordered_map<std::string, std::string_view> files) {
+    return [files = std::move(files)](std::string_view name) {
+        auto it = files.find(std::string(name));
+        if (it == files.end()) return ResolvedFile();
+        return ResolvedFile{it->second.data(), it->second.size(), nullptr, it->first};
+    };
+}
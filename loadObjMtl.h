@@ -1,100 +1,697 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <fstream>
-#include <sstream>
-#include <map>
+#include <cstdint>
+#include <tuple>
+#include <thread>
+#include <functional>
+#include <cstring>
+#include <memory_resource>
+#include "fileResolver.h"
+#include "loadStats.h"
+#include "memoryArena.h"
+#include "meshNormals.h"
+#include "objScan.h"
+#include "simd4.h"
+
+// One draw call: `count` indices starting at `firstIndex`, all using `material`.
+struct SubMesh {
+    int material;            // -1 = no material
+    unsigned int firstIndex;
+    unsigned int count;
+    unsigned int baseVertex = 0; // added to 16-bit indices, see buildIndex16
+};
+
+// A small run of triangles inside one SubMesh with bounds for CPU culling, see buildMeshlets.
+struct Meshlet {
+    uint32_t submesh;
+    uint32_t firstIndex;
+    uint32_t count;
+    float center[3], radius;
+    float coneAxis[3], coneCutoff;
+};
+
+// Level of detail i of a Mesh: the SubMeshes [firstSubmesh, firstSubmesh + submeshCount).
+// error is the simplifier's object-space deviation from LOD 0, see buildLods.
+struct MeshLod {
+    uint32_t firstSubmesh;
+    uint32_t submeshCount;
+    float error;
+};
+
+// Axis-aligned box of the positions and a sphere around its center that holds every vertex.
+struct MeshBounds {
+    float min[3] = {0,0,0}, max[3] = {0,0,0};
+    float center[3] = {0,0,0}, radius = 0;
+};
 
 struct Mesh {
-    std::vector<float> vertices; // x,y,z, u,v, nx,ny,nz
+    std::vector<float> vertices; // Layout::kFloats per vertex; x,y,z, u,v, nx,ny,nz for ObjLayoutPUN
     std::vector<unsigned int> indices;
+    std::vector<uint16_t> indices16; // filled by buildIndex16
+    std::vector<int> faceMat;    // material id per triangle, -1 = none
+    std::vector<SubMesh> submeshes;
+    std::vector<Meshlet> meshlets; // filled by buildMeshlets
+    std::vector<MeshLod> lods;     // filled by buildLods; empty = only LOD 0
+    MeshBounds bounds;
 };
 
 struct Material {
+    std::string name;
     float kd[3] = {1,1,1};
     std::string texPath;
 };
 
-inline Mesh loadObjMtl(const char* objPath, std::unordered_map<std::string, Material>& materials, const char* baseDir = "") {
-    Mesh mesh;
-    std::vector<Material> usedMaterials;
-    std::vector<float> pos, uv, norm;
-    std::vector<std::tuple<int,int,int>> faceData;
-    std::vector<int> faceMat;
-
-    std::ifstream in(objPath);
-    std::string line, currentMat;
-    while (std::getline(in,line)) {
-        std::istringstream iss(line);
-        std::string type; iss >> type;
-        if (type=="mtllib") {
-            std::string mtl; iss >> mtl;
-            std::ifstream m(std::string(baseDir) + mtl);
-            std::string l;
-            Material mat;
-            std::string name;
-            while (std::getline(m,l)) {
-                std::istringstream im(l);
-                std::string t; im >> t;
-                if (t=="newmtl") { if (!currentMat.empty()) materials[currentMat] = mat;
-                    im >> name; currentMat = name; mat = Material();
-                } else if (t=="Kd") { im >> mat.kd[0] >> mat.kd[1] >> mat.kd[2]; }
-                else if (t=="map_Kd") { im >> mat.texPath; }
+// Materials in first-mention order. An id is the index into `list` and stays valid for
+// the lifetime of the library, so faces can store it directly.
+struct MaterialLib {
+    std::vector<Material> list;
+    std::unordered_map<std::string, int> ids;
+
+    // Id for `name`; a name that was not defined yet gets a default material that a
+    // later newmtl fills in.
+    int intern(std::string_view name) {
+        auto [it, added] = ids.emplace(std::string(name), (int)list.size());
+        if (added) { list.emplace_back(); list.back().name = it->first; }
+        return it->second;
+    }
+
+    int find(std::string_view name) const {
+        auto it = ids.find(std::string(name));
+        return it == ids.end() ? -1 : it->second;
+    }
+
+    size_t size() const { return list.size(); }
+    void clear() { list.clear(); ids.clear(); }
+};
+
+// Helpers for walking a text buffer in place; nothing here allocates.
+namespace objtext {
+
+inline const char* lineEnd(const char* p, const char* end) {
+    const void* nl = memchr(p, '\n', end - p);
+    return nl ? (const char*)nl : end;
+}
+
+inline std::string_view token(const char*& p, const char* end) {
+    p = objscan::skipBlank(p, end);
+    const char* s = p;
+    while (p < end && !objscan::isBlank(*p)) ++p;
+    return std::string_view(s, p - s);
+}
+
+inline float readFloat(const char*& p, const char* end) {
+    float f = 0;
+    objscan::scanFloat(p, end, f);
+    return f;
+}
+
+} // namespace objtext
+
+inline void parseMtl(const char* data, size_t size, MaterialLib& materials) {
+    using namespace objtext;
+    const char* p = data;
+    const char* end = data + size;
+    Material* mat = nullptr;
+    Material ignored;
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        std::string_view t = token(p, eol);
+        if (t == "newmtl") {
+            mat = &materials.list[materials.intern(token(p, eol))];
+            std::string name = std::move(mat->name);
+            *mat = Material();
+            mat->name = std::move(name);
+        } else if (t == "Kd") {
+            Material& m = mat ? *mat : ignored;
+            m.kd[0] = readFloat(p, eol); m.kd[1] = readFloat(p, eol); m.kd[2] = readFloat(p, eol);
+        } else if (t == "map_Kd") {
+            (mat ? *mat : ignored).texPath = std::string(token(p, eol));
+        }
+        p = eol + (eol < end);
+    }
+}
+
+// Flat open-addressing map from (v,t,n) corner keys to vertex ids. It is sized for the
+// worst case (every corner unique) up front, so it never rehashes and stays under 2/3 full.
+struct CornerTable {
+    struct Slot { int v, t, n, id; };
+    std::pmr::vector<Slot> slots;
+    size_t mask;
+
+    explicit CornerTable(size_t corners, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) : slots(memory) {
+        size_t cap = capacity(corners);
+        slots.assign(cap, Slot{0,0,0,-1});
+        mask = cap - 1;
+    }
+
+    static size_t capacity(size_t corners) {
+        size_t cap = 16;
+        while (cap < corners + corners/2) cap <<= 1;
+        return cap;
+    }
+
+    static size_t hash(int v, int t, int n) {
+        uint64_t h = (uint32_t)v * 0x9E3779B97F4A7C15ull ^ (uint32_t)t * 0xC2B2AE3D27D4EB4Full ^ (uint32_t)n * 0x165667B19E3779F9ull;
+        return (size_t)(h ^ (h >> 29));
+    }
+
+    // Returns the id already stored for the key, or stores `next` and returns that.
+    int findOrInsert(int v, int t, int n, int next) {
+        for (size_t i = hash(v, t, n) & mask;; i = (i + 1) & mask) {
+            Slot& s = slots[i];
+            if (s.id < 0) { s = Slot{v, t, n, next}; return next; }
+            if (s.v == v && s.t == t && s.n == n) return s.id;
+        }
+    }
+};
+
+// Vertex layouts for loadObjMtlBuffer. A layout names the OBJ attributes that make a vertex
+// distinct and writes one vertex of kFloats floats. The parser and the interleave loop are
+// instantiated per layout, so an attribute the layout leaves out is neither stored, hashed
+// nor tested for in the inner loop.
+struct ObjLayoutP {
+    static constexpr bool kUV = false, kNormal = false;
+    static constexpr size_t kFloats = 3;
+    static void write(float* out, const float* p, const float*, const float*) {
+        out[0] = p[0]; out[1] = p[1]; out[2] = p[2];
+    }
+};
+
+struct ObjLayoutPN {
+    static constexpr bool kUV = false, kNormal = true;
+    static constexpr size_t kFloats = 6;
+    static void write(float* out, const float* p, const float*, const float* n) {
+        out[0] = p[0]; out[1] = p[1]; out[2] = p[2];
+        out[3] = n[0]; out[4] = n[1]; out[5] = n[2];
+    }
+};
+
+// The layout prepareMesh, the mesh cache and the renderer work with.
+struct ObjLayoutPUN {
+    static constexpr bool kUV = true, kNormal = true;
+    static constexpr size_t kFloats = 8;
+    static void write(float* out, const float* p, const float* t, const float* n) {
+        out[0] = p[0]; out[1] = p[1]; out[2] = p[2];
+        out[3] = t[0]; out[4] = t[1];
+        out[5] = n[0]; out[6] = n[1]; out[7] = n[2];
+    }
+};
+
+struct ObjLoadOptions {
+    unsigned threads = 0;        // parser threads, 0 = one per core (at most 8)
+    bool generateNormals = true; // smooth normals for corners without vn, see generateCornerNormals
+    NormalOptions normals;       // threads and memory are taken from the loader
+
+    // Every temporary of a load comes from one monotonic arena that is released in one go
+    // when the load returns; only the Mesh and the materials outlive it.
+    std::pmr::memory_resource* memory = nullptr; // where the arena gets its blocks; nullptr = the default resource
+    size_t arenaBytes = 0;                       // first block; 0 = the parse arrays and weld tables, estimated from the counts
+    ArenaStats* arenaStats = nullptr;            // filled in on return, for picking arenaBytes per asset
+
+    LoadStats* stats = nullptr;                  // added to when built with WGL_LOAD_STATS, see loadStats.h
+
+    // The options that change the resulting Mesh, for cache hashes.
+    uint64_t key() const {
+        uint32_t crease;
+        memcpy(&crease, &normals.creaseAngle, sizeof(crease));
+        uint64_t flags = (generateNormals ? 1 : 0) | (normals.weight == NormalWeight::Angle ? 2 : 0);
+        return (flags << 32 | (generateNormals ? crease : 0)) * 0xC2B2AE3D27D4EB4Full;
+    }
+};
+
+// Running box of the `v` records, one SIMD min and max per position as it is parsed.
+// The fourth lane repeats z so it never widens the box.
+struct BoundsAccumulator {
+    simd4::F4 lo = simd4::splat(1e30f), hi = simd4::splat(-1e30f);
+    bool empty = true;
+
+    void add(float x, float y, float z) {
+        const float p[4] = {x, y, z, z};
+        simd4::F4 v = simd4::load4(p);
+        lo = simd4::min4(lo, v);
+        hi = simd4::max4(hi, v);
+        empty = false;
+    }
+    void add(const BoundsAccumulator& o) {
+        lo = simd4::min4(lo, o.lo);
+        hi = simd4::max4(hi, o.hi);
+        empty = empty && o.empty;
+    }
+    // Box and center only; the radius is left for a pass that sees the used vertices.
+    MeshBounds bounds() const {
+        MeshBounds b;
+        if (empty) return b;
+        float l[4], h[4];
+        simd4::store4(l, lo);
+        simd4::store4(h, hi);
+        for (int k = 0; k < 3; ++k) {
+            b.min[k] = l[k];
+            b.max[k] = h[k];
+            b.center[k] = (l[k] + h[k]) * 0.5f;
+        }
+        return b;
+    }
+};
+
+// One slice of the OBJ text. The counting pass fills `counts`; the fill pass then writes
+// the slice's records straight into the shared ObjArrays from `base` on, the counts of all
+// slices before it, so relative indices resolve right away and nothing is merged later.
+struct ObjChunk {
+    struct Event { size_t face; bool lib; std::pmr::string name; };
+
+    objscan::RecordCounts counts, base;
+    BoundsAccumulator bounds;
+    std::pmr::vector<Event> events; // usemtl/mtllib, tagged with the slice's face count at that point
+
+    explicit ObjChunk(std::pmr::memory_resource* memory) : events(memory) {}
+};
+
+// Parse output for the whole file, sized by the counting pass.
+struct ObjArrays {
+    std::pmr::vector<float> pos, uv, norm;
+    std::pmr::vector<std::tuple<int,int,int>> faceData;
+
+    explicit ObjArrays(std::pmr::memory_resource* memory) : pos(memory), uv(memory), norm(memory), faceData(memory) {}
+};
+
+template <class Layout>
+void parseObjChunk(const char* p, const char* end, ObjChunk& c, ObjArrays& a) {
+    using namespace objtext;
+    using namespace objscan;
+    float* pos = a.pos.data() + c.base.v*3;
+    float* uv = Layout::kUV ? a.uv.data() + c.base.vt*2 : nullptr;
+    float* norm = Layout::kNormal ? a.norm.data() + c.base.vn*3 : nullptr;
+    std::tuple<int,int,int>* const firstCorner = a.faceData.data() + c.base.corners;
+    std::tuple<int,int,int>* corner = firstCorner;
+    size_t nv = c.base.v, nt = c.base.vt, nn = c.base.vn; // records so far, for relative indices
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        std::string_view type = token(p, eol);
+        if (type == "v") {
+            float x = readFloat(p, eol), y = readFloat(p, eol), z = readFloat(p, eol);
+            *pos++ = x; *pos++ = y; *pos++ = z;
+            c.bounds.add(x, y, z);
+            ++nv;
+        } else if (type == "vt") {
+            if constexpr (Layout::kUV) {
+                *uv++ = readFloat(p, eol);
+                *uv++ = readFloat(p, eol);
+            }
+            ++nt;
+        } else if (type == "vn") {
+            if constexpr (Layout::kNormal) {
+                *norm++ = readFloat(p, eol);
+                *norm++ = readFloat(p, eol);
+                *norm++ = readFloat(p, eol);
+            }
+            ++nn;
+        } else if (type == "f") {
+            // polygons are fan-triangulated around their first corner
+            std::tuple<int,int,int> first, prev;
+            int corners = 0, raw[3];
+            for (; scanCorner(p, eol, raw[0], raw[1], raw[2]); ++corners) {
+                std::tuple<int,int,int> cur(resolveIndex(raw[0], nv), resolveIndex(raw[1], nt), resolveIndex(raw[2], nn));
+                if (corners >= 2) {
+                    *corner++ = first;
+                    *corner++ = prev;
+                    *corner++ = cur;
+                }
+                if (corners == 0) first = cur;
+                prev = cur;
+            }
+        } else if (type == "usemtl" || type == "mtllib") {
+            c.events.push_back({(size_t)(corner - firstCorner)/3, type == "mtllib", std::pmr::string(token(p, eol), c.events.get_allocator())});
+        }
+        p = eol + (eol < end);
+    }
+}
+
+// Splits [data, data+size) at line boundaries into at most `parts` slices of at least `minBytes`.
+inline std::pmr::vector<const char*> splitLines(const char* data, size_t size, unsigned parts, size_t minBytes, std::pmr::memory_resource* memory) {
+    if (parts > size / minBytes) parts = (unsigned)(size / minBytes);
+    if (parts < 1) parts = 1;
+    std::pmr::vector<const char*> cuts(memory);
+    cuts.reserve(parts + 1);
+    cuts.push_back(data);
+    const char* end = data + size;
+    for (unsigned i = 1; i < parts; ++i) {
+        const char* p = objtext::lineEnd(data + size / parts * i, end);
+        if (p < end) ++p;
+        if (p > cuts.back() && p < end) cuts.push_back(p);
+    }
+    cuts.push_back(end);
+    return cuts;
+}
+
+const size_t kMinCornersPerWeldThread = 1 << 16; // below this a weld thread costs more than it saves
+
+inline unsigned parserThreads(const ObjLoadOptions& opt) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    (void)opt;
+    return 1; // no SharedArrayBuffer without -pthread
+#else
+    unsigned n = opt.threads ? opt.threads : std::thread::hardware_concurrency();
+    return n < 1 ? 1 : n > 8 ? 8 : n;
+#endif
+}
+
+// Appends the material of each of the chunk's triangles to faceMat, switching at usemtl
+// and reading mtllib files through `resolve` where they appear. Returns the milliseconds
+// spent on MTL files when `stats` is set.
+inline double applyObjEvents(const ObjChunk& c, MaterialLib& materials, const FileResolver& resolve, int& currentMat,
+                             std::vector<int>& faceMat, LoadStats* stats) {
+    double mtlMs = 0;
+    size_t faces = c.counts.faces(), e = 0;
+    for (size_t f = 0; f <= faces; ++f) {
+        for (; e < c.events.size() && c.events[e].face == f; ++e) {
+            if (!c.events[e].lib) { currentMat = materials.intern(c.events[e].name); continue; }
+            StatClock mtlClock;
+            ResolvedFile mtl = resolve ? resolve(c.events[e].name) : ResolvedFile();
+            if (mtl) parseMtl(mtl.data, mtl.size, materials);
+            if (stats) {
+                mtlMs += mtlClock.lap();
+                stats->bytesRead += mtl.size;
             }
-            if (!currentMat.empty()) materials[currentMat] = mat;
-        } else if (type=="usemtl") {
-            iss >> currentMat;
-        } else if (type=="v") {
-            float x,y,z; iss>>x>>y>>z;
-            pos.insert(pos.end(),{x,y,z});
-        } else if (type=="vt") {
-            float u,v; iss>>u>>v;
-            uv.insert(uv.end(),{u,v});
-        } else if (type=="vn") {
-            float nx,ny,nz; iss>>nx>>ny>>nz;
-            norm.insert(norm.end(),{nx,ny,nz});
-        } else if (type=="f") {
-            std::string a,b,c;
-            iss>>a>>b>>c;
-            auto parseIdx=[&](const std::string& s){
-                int v=-1, t=-1, n=-1;
-                sscanf(s.c_str(), "%d/%d/%d",&v,&t,&n);
-                return std::make_tuple(v-1, t-1, n-1);
-            };
-            faceData.push_back(parseIdx(a));
-            faceData.push_back(parseIdx(b));
-            faceData.push_back(parseIdx(c));
-            faceMat.push_back(currentMat.empty()? -1 : std::distance(materials.begin(), materials.find(currentMat)));
         }
+        if (f < faces) faceMat.push_back(currentMat);
+    }
+    return mtlMs;
+}
+
+// Removes the triangles from corner `first` on that have a corner without a position (an
+// index out of range), along with their faceMat entries. Returns how many were removed.
+inline size_t dropInvalidTriangles(std::pmr::vector<std::tuple<int,int,int>>& faceData, std::vector<int>& faceMat, size_t first) {
+    size_t to = first;
+    for (size_t c = first; c + 3 <= faceData.size(); c += 3) {
+        if (std::get<0>(faceData[c]) < 0 || std::get<0>(faceData[c+1]) < 0 || std::get<0>(faceData[c+2]) < 0) continue;
+        if (to != c) {
+            std::copy(&faceData[c], &faceData[c] + 3, &faceData[to]);
+            faceMat[to/3] = faceMat[c/3];
+        }
+        to += 3;
+    }
+    size_t dropped = (faceData.size() - to) / 3;
+    faceData.resize(to);
+    faceMat.resize(to / 3);
+    return dropped;
+}
+
+// Stable counting sort of the triangles by material id (untextured faces first), then one
+// SubMesh per material that has faces. The sort's copies come from `memory`.
+inline void groupByMaterial(Mesh& mesh, size_t materialCount, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    size_t tris = mesh.faceMat.size();
+    std::pmr::vector<unsigned int> first(materialCount + 2, 0, memory); // first triangle of material id m at [m+1]
+    for (int m : mesh.faceMat) ++first[m + 2];
+    for (size_t i = 1; i < first.size(); ++i) first[i] += first[i-1];
+
+    mesh.submeshes.clear();
+    for (size_t i = 0; i + 1 < first.size(); ++i)
+        if (first[i+1] > first[i]) mesh.submeshes.push_back({(int)i - 1, first[i] * 3, (first[i+1] - first[i]) * 3});
+    if (mesh.submeshes.size() < 2) return;
+
+    std::pmr::vector<unsigned int> indices(mesh.indices.begin(), mesh.indices.end(), memory);
+    std::pmr::vector<int> faceMat(mesh.faceMat.begin(), mesh.faceMat.end(), memory);
+    for (size_t t = 0; t < tris; ++t) {
+        unsigned int d = first[faceMat[t] + 1]++;
+        mesh.faceMat[d] = faceMat[t];
+        memcpy(&mesh.indices[d*3], &indices[t*3], 3 * sizeof(unsigned int));
     }
+}
 
-    // build interleaved buffer
-    std::unordered_map<std::string,int> matIdMap;
-    
-    std::map<std::tuple<int,int,int>, int> uniqueMap;
-int idx=0;
-for (size_t i=0; i<faceData.size(); ++i) {
-    auto t = faceData[i];
-    if (uniqueMap.count(t) == 0) {
-        uniqueMap[t] = idx++;
-        auto [vi, ti, ni] = t;
-        mesh.vertices.push_back(pos[vi*3+0]);
-        mesh.vertices.push_back(pos[vi*3+1]);
-        mesh.vertices.push_back(pos[vi*3+2]);
-        if (ti >= 0) {
-            mesh.vertices.push_back(uv[ti*2+0]);
-            mesh.vertices.push_back(uv[ti*2+1]);
-        } else mesh.vertices.insert(mesh.vertices.end(), {0,0});
-        if (ni >= 0) {
-            mesh.vertices.push_back(norm[ni*3+0]);
-            mesh.vertices.push_back(norm[ni*3+1]);
-            mesh.vertices.push_back(norm[ni*3+2]);
-        } else mesh.vertices.insert(mesh.vertices.end(), {0,0,1});
-    }
-    mesh.indices.push_back(uniqueMap[t]);
+// Gives every corner without a normal a generated one. New normals are appended to `norm`;
+// corners at the same position that end up with the same normal share one entry, so the
+// interleave below still welds them into one vertex.
+inline void addMissingNormals(const std::pmr::vector<float>& pos, std::pmr::vector<float>& norm, std::pmr::vector<std::tuple<int,int,int>>& faceData, const ObjLoadOptions& opt) {
+    std::pmr::memory_resource* mem = norm.get_allocator().resource();
+    std::pmr::vector<uint32_t> missing(mem);
+    for (size_t c = 0; c < faceData.size(); ++c) if (std::get<2>(faceData[c]) < 0) missing.push_back((uint32_t)c);
+    if (missing.empty()) return;
+
+    std::pmr::vector<int> corners(faceData.size(), mem);
+    for (size_t c = 0; c < corners.size(); ++c) corners[c] = std::get<0>(faceData[c]);
+    NormalOptions no = opt.normals;
+    no.threads = parserThreads(opt);
+    no.memory = mem;
+    std::pmr::vector<float> normals(mem);
+    generateCornerNormals(pos.data(), pos.size()/3, corners.data(), corners.size(), normals, no);
+
+    auto key = [&](uint32_t c) {
+        uint32_t b[3];
+        memcpy(b, &normals[c*3], sizeof(b));
+        return std::make_tuple(corners[c], b[0], b[1], b[2]);
+    };
+    std::pmr::vector<uint32_t> order(missing, mem);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+    auto fresh = [&](size_t i) { return i == 0 || key(order[i-1]) != key(order[i]); };
+    size_t added = 0, n = norm.size()/3 - 1;
+    for (size_t i = 0; i < order.size(); ++i) added += fresh(i);
+    norm.resize(norm.size() + added*3);
+    for (size_t i = 0; i < order.size(); ++i) {
+        uint32_t c = order[i];
+        if (fresh(i)) memcpy(&norm[++n*3], &normals[c*3], 3 * sizeof(float));
+        std::get<2>(faceData[c]) = (int)n;
+    }
 }
 
+// Parses an OBJ that is already in memory (mapped file, fetch result, embedded data);
+// `resolve` supplies the mtllib files it names. The buffer does not need to be null
+// terminated and is only read, never copied.
+// Large inputs are parsed in slices on several threads; the merge walks the slices in
+// file order, so the result does not depend on the thread count.
+template <class Layout = ObjLayoutPUN>
+Mesh loadObjMtlBuffer(std::string_view obj, MaterialLib& materials, const FileResolver& resolve, const ObjLoadOptions& opt = {}) {
+    const char* data = obj.data();
+    size_t size = obj.size();
+    Mesh mesh;
+    LoadStats* stats = kLoadStats ? opt.stats : nullptr;
+    StatClock clock, start;
+    // the arena's blocks, and before it is sized the slices and their counts
+    CountingResource blocks(opt.memory ? opt.memory : std::pmr::get_default_resource());
 
+    std::pmr::vector<const char*> cuts = splitLines(data, size, parserThreads(opt), 1 << 20, &blocks);
+    size_t parts = cuts.size() - 1;
+    auto perPart = [&](auto&& work) {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < parts; ++i) workers.emplace_back(work, i);
+        work(0);
+        for (std::thread& w : workers) w.join();
+    };
+
+    // count, then parse into arrays of the final size: no regrowth and no second copy
+    std::pmr::vector<objscan::RecordCounts> counts(parts, &blocks);
+    perPart([&](size_t i) { counts[i] = objscan::countRecords(cuts[i], cuts[i+1]); });
+    objscan::RecordCounts total;
+    for (const objscan::RecordCounts& c : counts) total += c;
+    if (stats) {
+        stats->countMs += clock.lap();
+        stats->bytesRead += size;
+        stats->positions += total.v; stats->texcoords += total.vt; stats->normals += total.vn;
+        stats->triangles += total.faces(); stats->corners += total.corners;
+    }
+
+    size_t weldParts = std::max<size_t>(1, std::min<size_t>(parserThreads(opt), total.corners / kMinCornersPerWeldThread));
+    size_t arenaBytes = opt.arenaBytes;
+    if (!arenaBytes) {
+        // plus some room for events, names and alignment, so the arena does not start a
+        // second, larger block for the last few bytes
+        arenaBytes = total.v*3*sizeof(float) + total.corners*sizeof(std::tuple<int,int,int>) + (64 << 10);
+        // the weld: its tables, whose sizes vary a little with the hash when there are
+        // several, the vertex list and per corner the table it goes to
+        size_t perTable = weldParts == 1 ? total.corners : total.corners / weldParts * 9 / 8;
+        arenaBytes += weldParts * CornerTable::capacity(perTable) * sizeof(CornerTable::Slot) + total.corners * sizeof(uint32_t);
+        if (weldParts > 1) arenaBytes += total.corners;
+        // groupByMaterial's copies of the indices and faceMat
+        arenaBytes += total.corners * sizeof(unsigned int) + total.faces() * sizeof(int);
+        if constexpr (Layout::kUV) arenaBytes += total.vt*2*sizeof(float);
+        if constexpr (Layout::kNormal) arenaBytes += total.vn*3*sizeof(float);
+    }
+    // the counters lock, which also makes the arena safe for the parser threads
+    std::pmr::monotonic_buffer_resource arenaBuffer(arenaBytes, &blocks);
+    CountingResource arena(&arenaBuffer);
+
+    std::pmr::vector<ObjChunk> chunks(&arena);
+    chunks.reserve(parts);
+    objscan::RecordCounts base;
+    for (size_t i = 0; i < parts; ++i) {
+        chunks.emplace_back(&arena);
+        chunks[i].counts = counts[i];
+        chunks[i].base = base;
+        base += counts[i];
+    }
+    ObjArrays arrays(&arena);
+    arrays.pos.resize(total.v*3);
+    if constexpr (Layout::kUV) arrays.uv.resize(total.vt*2);
+    if constexpr (Layout::kNormal) arrays.norm.resize(total.vn*3);
+    arrays.faceData.resize(total.corners);
+    mesh.faceMat.reserve(total.faces());
+    perPart([&](size_t i) { parseObjChunk<Layout>(cuts[i], cuts[i+1], chunks[i], arrays); });
+    const std::pmr::vector<float>& pos = arrays.pos;
+    const std::pmr::vector<float>& uv = arrays.uv;
+    std::pmr::vector<float>& norm = arrays.norm;
+    std::pmr::vector<std::tuple<int,int,int>>& faceData = arrays.faceData;
+
+    double mtlMs = 0;
+    int currentMat = -1;
+    BoundsAccumulator bounds;
+    for (ObjChunk& c : chunks) {
+        bounds.add(c.bounds);
+        mtlMs += applyObjEvents(c, materials, resolve, currentMat, mesh.faceMat, stats);
+    }
+    size_t dropped = dropInvalidTriangles(faceData, mesh.faceMat, 0);
+    if (stats) stats->triangles -= dropped;
+
+    size_t fileNormals = norm.size();
+    if (stats) {
+        stats->mtlMs += mtlMs;
+        stats->parseMs += clock.lap() - mtlMs;
+    }
+
+    if constexpr (Layout::kNormal)
+        if (opt.generateNormals) addMissingNormals(pos, norm, faceData, opt);
+    if (stats) {
+        stats->normalsMs += clock.lap();
+        stats->generatedNormals += (norm.size() - fileNormals) / 3;
+    }
+
+    // Weld corners into vertices. The corners are split by key hash into one table per
+    // thread, so no table is shared; each table maps a key to the first corner that has it.
+    // Ids then go to those first corners in corner order, which is the order a single
+    // table would hand them out in, so the result does not depend on the thread count.
+    static const float noUV[2] = {0,0}, noNormal[3] = {0,0,1};
+    auto attribs = [&](size_t i) {
+        auto [vi, ti, ni] = faceData[i];
+        if constexpr (!Layout::kUV) ti = -1;
+        if constexpr (!Layout::kNormal) ni = -1;
+        return std::make_tuple(vi, ti, ni);
+    };
+    size_t corners = faceData.size();
+    auto perSlice = [&](auto&& work) {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < weldParts; ++i) workers.emplace_back(work, i, corners * i / weldParts, corners * (i + 1) / weldParts);
+        work(0, 0, corners / weldParts);
+        for (std::thread& w : workers) w.join();
+    };
+    auto tableOf = [&](size_t i) {
+        auto [vi, ti, ni] = attribs(i);
+        return (CornerTable::hash(vi, ti, ni) >> 48) % weldParts;
+    };
+
+    std::pmr::vector<uint8_t> table(weldParts > 1 ? corners : 0, &arena);
+    std::pmr::vector<size_t> tableSize(weldParts * weldParts, 0, &arena); // [slice * weldParts + table]
+    if (weldParts > 1) {
+        perSlice([&](size_t slice, size_t from, size_t to) {
+            for (size_t i = from; i < to; ++i) ++tableSize[slice * weldParts + (table[i] = (uint8_t)tableOf(i))];
+        });
+    } else {
+        tableSize[0] = corners;
+    }
+    std::pmr::vector<CornerTable> tables(&arena);
+    tables.reserve(weldParts);
+    for (size_t t = 0; t < weldParts; ++t) {
+        size_t n = 0;
+        for (size_t slice = 0; slice < weldParts; ++slice) n += tableSize[slice * weldParts + t];
+        tables.emplace_back(n, &arena);
+    }
+    mesh.indices.resize(corners);
+    unsigned int vertexCount = 0;
+    std::pmr::vector<uint32_t> newVertex(&arena); // corners that start a vertex, in id order
+    if (weldParts == 1) {
+        newVertex.reserve(corners);
+        for (size_t i = 0; i < corners; ++i) {
+            auto [vi, ti, ni] = attribs(i);
+            int id = tables[0].findOrInsert(vi, ti, ni, (int)vertexCount);
+            if (id == (int)vertexCount) {
+                newVertex.push_back((uint32_t)i);
+                ++vertexCount;
+            }
+            mesh.indices[i] = id;
+        }
+    } else {
+        unsigned int* first = mesh.indices.data(); // first corner with the same key, then the id
+        perSlice([&](size_t t, size_t, size_t) {
+            CornerTable& unique = tables[t];
+            for (size_t i = 0; i < corners; ++i) {
+                if (table[i] != t) continue;
+                auto [vi, ti, ni] = attribs(i);
+                first[i] = (unsigned int)unique.findOrInsert(vi, ti, ni, (int)i);
+            }
+        });
+
+        // ids in corner order: count the new vertices per slice, then number them
+        std::pmr::vector<unsigned int> firstId(weldParts + 1, 0, &arena);
+        perSlice([&](size_t slice, size_t from, size_t to) {
+            for (size_t i = from; i < to; ++i) firstId[slice + 1] += first[i] == i;
+        });
+        for (size_t slice = 0; slice < weldParts; ++slice) firstId[slice + 1] += firstId[slice];
+        vertexCount = firstId[weldParts];
+        newVertex.resize(vertexCount);
+        perSlice([&](size_t slice, size_t from, size_t to) {
+            unsigned int id = firstId[slice];
+            for (size_t i = from; i < to; ++i) if (first[i] == i) { newVertex[id] = (uint32_t)i; first[i] = id++; }
+        });
+        // a corner that did not start a vertex still holds the corner that did, which now
+        // holds the id; newVertex points back exactly at the corners that started one
+        perSlice([&](size_t, size_t from, size_t to) {
+            for (size_t i = from; i < to; ++i)
+                if (first[i] >= vertexCount || newVertex[first[i]] != i) first[i] = first[first[i]];
+        });
+    }
+    if (stats) {
+        stats->weldMs += clock.lap();
+        stats->vertices += vertexCount;
+    }
+
+    // write each vertex from the corner that started it; the radius comes from the
+    // positions that get used
+    mesh.bounds = bounds.bounds();
+    const float* center = mesh.bounds.center;
+    mesh.vertices.resize((size_t)vertexCount * Layout::kFloats);
+    std::pmr::vector<float> sliceR2(weldParts, 0, &arena);
+    perSlice([&](size_t slice, size_t, size_t) {
+        float r2 = 0;
+        for (size_t id = vertexCount * slice / weldParts; id < vertexCount * (slice + 1) / weldParts; ++id) {
+            auto [vi, ti, ni] = attribs(newVertex[id]);
+            const float* p = &pos[vi*3];
+            float dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+            r2 = std::max(r2, dx*dx + dy*dy + dz*dz);
+            Layout::write(&mesh.vertices[id * Layout::kFloats], p, ti >= 0 ? &uv[ti*2] : noUV, ni >= 0 ? &norm[ni*3] : noNormal);
+        }
+        sliceR2[slice] = r2;
+    });
+    float r2 = *std::max_element(sliceR2.begin(), sliceR2.end());
+    mesh.bounds.radius = std::sqrt(r2);
+    if (stats) stats->interleaveMs += clock.lap();
+
+    groupByMaterial(mesh, materials.size(), &arena);
+    if (opt.arenaStats) *opt.arenaStats = {arena.bytes(), arena.allocations(), blocks.bytes()};
+    if (stats) {
+        stats->groupMs += clock.lap();
+        stats->tempBytes += blocks.bytes();
+        stats->totalMs += start.lap();
+    }
     return mesh;
 }
+
+// mtllib names are looked up under `baseDir`.
+template <class Layout = ObjLayoutPUN>
+Mesh loadObjMtlBuffer(const char* data, size_t size, MaterialLib& materials, const char* baseDir = "", const ObjLoadOptions& opt = {}) {
+    return loadObjMtlBuffer<Layout>(std::string_view(data, size), materials, fileResolver(baseDir), opt);
+}
+
+template <class Layout = ObjLayoutPUN>
+Mesh loadObjMtl(const char* objPath, MaterialLib& materials, const char* baseDir = "", const ObjLoadOptions& opt = {}) {
+    StatClock clock;
+    MappedFile file(objPath);
+    if (!file) return Mesh();
+    if (kLoadStats && opt.stats) {
+        double ms = clock.lap();
+        opt.stats->mapMs += ms;
+        opt.stats->totalMs += ms;
+    }
+    return loadObjMtlBuffer<Layout>(file.data, file.size, materials, baseDir, opt);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+// Per-phase timings and counters of a mesh load. Only collected when built with
+// -DWGL_LOAD_STATS=1; otherwise the loaders never touch the clock or the struct, and the
+// stats pointers they take are dead code.
+#ifndef WGL_LOAD_STATS
+#define WGL_LOAD_STATS 0
+#endif
+
+const bool kLoadStats = WGL_LOAD_STATS != 0;
+
+// Everything is added to, so one LoadStats can sum several loads.
+struct LoadStats {
+    // milliseconds
+    double mapMs = 0;       // opening and mapping the OBJ
+    double hashMs = 0;      // loadMeshCached: hashing the OBJ and MTL sources
+    double cacheMs = 0;     // loadMeshCached: mapping and decoding the .wglmesh
+    double countMs = 0;     // counting prepass; also where a mapped file is paged in
+    double parseMs = 0;     // tokenizing into the parse arrays
+    double mtlMs = 0;       // reading and parsing MTL files
+    double normalsMs = 0;   // generating missing normals
+    double weldMs = 0;      // corner dedup
+    double interleaveMs = 0;
+    double groupMs = 0;     // sorting triangles by material
+    double prepareMs = 0;   // loadMeshCached: prepareMesh and quantization
+    double writeMs = 0;     // loadMeshCached: writing the .wglmesh
+    double totalMs = 0;
+
+    size_t bytesRead = 0;   // OBJ and MTL text, or the cache file
+    size_t positions = 0, texcoords = 0, normals = 0, triangles = 0;
+    size_t corners = 0;     // triangle corners before welding
+    size_t vertices = 0;    // after welding
+    size_t generatedNormals = 0;
+    size_t tempBytes = 0;   // what the loader's arena took, its peak temporary memory
+    bool fromCache = false;
+
+    // Share of corners that reused an existing vertex.
+    double dedupHitRate() const { return corners ? 1.0 - (double)vertices / corners : 0; }
+};
+
+// Milliseconds between laps; does not read the clock unless WGL_LOAD_STATS is on.
+struct StatClock {
+    std::chrono::steady_clock::time_point last;
+
+    StatClock() { if (kLoadStats) last = std::chrono::steady_clock::now(); }
+    double lap() {
+        if (!kLoadStats) return 0;
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - last).count();
+        last = now;
+        return ms;
+    }
+};
+
+inline void printLoadStats(const LoadStats& s) {
+    if (s.fromCache) {
+        printf("Load: %.2f ms from cache (hash %.2f, map+decode %.2f), %zu bytes\n", s.totalMs, s.hashMs, s.cacheMs, s.bytesRead);
+        return;
+    }
+    printf("Load: %.2f ms, %zu bytes read, %zu KB temporary\n", s.totalMs, s.bytesRead, s.tempBytes >> 10);
+    printf("  map %.2f  count %.2f  parse %.2f  mtl %.2f  normals %.2f  weld %.2f  interleave %.2f  group %.2f  prepare %.2f  write %.2f ms\n",
+           s.mapMs, s.countMs, s.parseMs, s.mtlMs, s.normalsMs, s.weldMs, s.interleaveMs, s.groupMs, s.prepareMs, s.writeMs);
+    printf("  %zu v, %zu vt, %zu vn, %zu triangles; %zu corners -> %zu vertices (%.1f%% dedup hits), %zu normals generated\n",
+           s.positions, s.texcoords, s.normals, s.triangles, s.corners, s.vertices, 100 * s.dedupHitRate(), s.generatedNormals);
+}
@@ -1,20 +1,118 @@
 #include <SDL.h>
 #include <GLES2/gl2.h>
 #include <emscripten.h>
-#include "loadObjMtl.h"
+#include <emscripten/fetch.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include "meshCache.h"
+#include "objStream.h"
+#include "textureCache.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 SDL_Window* window;
 SDL_GLContext glContext;
-Mesh mesh;
-GLuint program, vbo, ibo, tex = 0;
-std::unordered_map<std::string, Material> materials;
+GLuint program = 0, vbo, ibo, whiteTex = 0;
+GLint kdLoc = -1;
+GLenum indexType = GL_UNSIGNED_INT;
+GLsizei indexSize = 4;
+VertexFormat vertexFormat;
+MaterialLib materials;
+
+// One submesh of one LOD, ordered by LOD and then texture so each texture is bound once
+// per frame. With meshlets the range is drawn as the runs of meshlets that survive culling.
+struct Draw {
+    unsigned int lod;
+    GLuint tex;
+    float kd[3];
+    unsigned int firstIndex, count, baseVertex;
+    unsigned int firstMeshlet, meshletCount;
+};
+std::vector<Draw> draws;
+std::vector<Meshlet> meshlets;
+std::vector<MeshLod> lods;
+MeshBounds bounds;
+GLint mvpLoc = -1, normalMatLoc = -1;
+std::vector<GLuint> materialTex; // per material, whiteTex when it has no texture
+FileResolver assets = fileResolver("asserts/");
+TextureCache textures;
+
+// How the OBJ is parsed, cached or streamed. OBJs without vn keep hard edges sharper than
+// kDefaultCreaseAngle instead of being smoothed all over.
+ObjLoadOptions meshLoadOptions(LoadStats* stats = nullptr) {
+    ObjLoadOptions load;
+    load.normals.creaseAngle = kDefaultCreaseAngle;
+    load.stats = stats;
+    return load;
+}
 
-float rotX=0, rotY=0;
+// An OBJ without a baked cache, drawn while it downloads: every frame feeds the next slice
+// of the received bytes to the parser and appends what that added to the buffers, which
+// grow by doubling. Indices go up as 16 bits relative to each draw's base vertex, so no
+// extension is needed. Once all of it is parsed the prepared mesh replaces it.
+struct StreamLoad {
+    LoadStats stats;           // before the parser, which adds to it
+    ObjStreamParser<> parser{materials, assets, meshLoadOptions(&stats)};
+    std::vector<char> bytes;   // received so far
+    size_t fed = 0;
+    bool received = false, failed = false;
+    size_t vboBytes = 0, iboBytes = 0;          // buffer capacities
+    size_t uploadedVertices = 0, drawnTriangles = 0;
+    std::vector<uint16_t> indices;              // what the index buffer holds
+    int lastMaterial = -2;                      // material of draws.back()
+};
+std::unique_ptr<StreamLoad> streamLoad;
+const size_t kStreamBytesPerFrame = 2 << 20;
+
+const int kWidth = 800, kHeight = 600;
+const float kFovY = 0.785398f; // 45 degrees
+
+float rotX=0, rotY=0, zoom=1;
 bool mouseDown=false;
 int lastX, lastY;
 
+// Column-major 4x4 matrix, as glUniformMatrix4fv takes it.
+struct Mat4 { float m[16]; };
+
+Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+    for (int c = 0; c < 4; ++c)
+        for (int i = 0; i < 4; ++i)
+            r.m[c*4 + i] = a.m[i]*b.m[c*4] + a.m[4 + i]*b.m[c*4 + 1] + a.m[8 + i]*b.m[c*4 + 2] + a.m[12 + i]*b.m[c*4 + 3];
+    return r;
+}
+
+Mat4 scaleTranslate(const float s[3], const float t[3]) {
+    return {{s[0],0,0,0, 0,s[1],0,0, 0,0,s[2],0, t[0],t[1],t[2],1}};
+}
+
+// Rotation about y after rotation about x.
+Mat4 rotation(float ax, float ay) {
+    float cx = cosf(ax), sx = sinf(ax), cy = cosf(ay), sy = sinf(ay);
+    Mat4 rx = {{1,0,0,0, 0,cx,-sx,0, 0,sx,cx,0, 0,0,0,1}};
+    Mat4 ry = {{cy,0,sy,0, 0,1,0,0, -sy,0,cy,0, 0,0,0,1}};
+    return ry * rx;
+}
+
+Mat4 perspective(float fovY, float aspect, float zNear, float zFar) {
+    float f = 1 / tanf(fovY * 0.5f);
+    return {{f/aspect,0,0,0, 0,f,0,0, 0,0,(zFar + zNear)/(zNear - zFar),-1, 0,0,2*zFar*zNear/(zNear - zFar),0}};
+}
+
+// True when the sphere is entirely outside one of the clip planes of `m` (Gribb-Hartmann).
+bool sphereOutside(const Mat4& m, const float center[3], float radius) {
+    for (int p = 0; p < 6; ++p) {
+        int axis = p / 2;
+        float sign = p % 2 ? -1.0f : 1.0f;
+        float plane[4];
+        for (int c = 0; c < 4; ++c) plane[c] = m.m[c*4 + 3] + sign * m.m[c*4 + axis];
+        float len = sqrtf(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+        if (plane[0]*center[0] + plane[1]*center[1] + plane[2]*center[2] + plane[3] < -radius * len) return true;
+    }
+    return false;
+}
+
 const char* vs = R"(
 attribute vec3 aPos;
 attribute vec2 aUV;
@@ -23,18 +121,30 @@ attribute vec3 aNormal;
 varying vec2 vUV;
 varying vec3 vNormal;
 
-uniform float rotX, rotY;
+// uMVP includes the position dequantization, see VertexFormat; uNormalMat is the rotation.
+uniform mat4 uMVP;
+uniform mat3 uNormalMat;
+uniform vec2 uUvScale, uUvOffset;
+
+#ifdef OCT_NORMAL
+vec3 octDecode(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), step(vec2(0.0), n.xy));
+    return normalize(n);
+}
+#endif
 
 void main(){
-    float cx = cos(rotX), sx=sin(rotX);
-    float cy = cos(rotY), sy=sin(rotY);
-    mat3 Rx = mat3(1,0,0, 0,cx,-sx, 0,sx,cx);
-    mat3 Ry = mat3(cy,0,sy, 0,1,0, -sy,0,cy);
-    vec3 p = Ry * Rx * aPos;
-    gl_Position = vec4(p * 0.5 + vec3(0.0, 0.0, -1.0), 1.0);
-
-    vUV = aUV;
-    vNormal = normalize(Ry * Rx * aNormal);
+    gl_Position = uMVP * vec4(aPos, 1.0);
+
+    vUV = aUV * uUvScale + uUvOffset;
+#ifdef OCT_NORMAL
+    vec3 n = octDecode(aNormal.xy / 127.0);
+#else
+    vec3 n = aNormal;
+#endif
+    vNormal = normalize(uNormalMat * n);
 }
 )";
 
@@ -44,21 +154,23 @@ precision mediump float;
 varying vec2 vUV;
 varying vec3 vNormal;
 uniform sampler2D tex;
+uniform vec3 uKd;
 
 void main() {
     vec3 lightDir = normalize(vec3(0.5, 1.0, 0.75));
     float diff = max(dot(vNormal, lightDir), 0.0);
 
     vec4 texColor = texture2D(tex, vUV);
-    vec3 color = texColor.rgb * diff;
+    vec3 color = texColor.rgb * uKd * diff;
 
     gl_FragColor = vec4(color, texColor.a);
 }
 )";
 
-GLuint compileShader(GLenum type, const char* source) {
+GLuint compileShader(GLenum type, const char* source, const char* defines = "") {
     GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
+    const char* sources[2] = {defines, source};
+    glShaderSource(shader, 2, sources, nullptr);
     glCompileShader(shader);
 
     GLint success;
@@ -72,21 +184,10 @@ GLuint compileShader(GLenum type, const char* source) {
     return shader;
 }
 
-bool init(){
-    SDL_Init(SDL_INIT_VIDEO);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION,2);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
-    window = SDL_CreateWindow("Obj+Mtl Loader", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800,600, SDL_WINDOW_OPENGL);
-    glContext = SDL_GL_CreateContext(window);
-    glViewport(0,0,800,600);
-
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(1.0f, 0.1f, 0.1f, 1.0f);
-
-    mesh = loadObjMtl("asserts/cube.obj", materials, "asserts/");
-    printf("Verts: %zu, idx: %zu\n", mesh.vertices.size()/8, mesh.indices.size());
-
-    GLuint vsId = compileShader(GL_VERTEX_SHADER, vs);
+// (Re)links the program for vertexFormat.
+void buildProgram() {
+    if (program) glDeleteProgram(program);
+    GLuint vsId = compileShader(GL_VERTEX_SHADER, vs, vertexFormat.octNormal ? "#define OCT_NORMAL\n" : "");
     GLuint fsId = compileShader(GL_FRAGMENT_SHADER, fs);
     program = glCreateProgram();
     glAttachShader(program, vsId);
@@ -95,59 +196,321 @@ bool init(){
     glBindAttribLocation(program, 1, "aUV");
     glBindAttribLocation(program, 2, "aNormal");
     glLinkProgram(program);
+    glDeleteShader(vsId);
+    glDeleteShader(fsId);
 
-    glGenBuffers(1,&vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size()*sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "tex"), 0);
+    kdLoc = glGetUniformLocation(program, "uKd");
+    mvpLoc = glGetUniformLocation(program, "uMVP");
+    normalMatLoc = glGetUniformLocation(program, "uNormalMat");
+    glUniform2fv(glGetUniformLocation(program, "uUvScale"), 1, vertexFormat.uvScale);
+    glUniform2fv(glGetUniformLocation(program, "uUvOffset"), 1, vertexFormat.uvOffset);
+}
 
-    glGenBuffers(1,&ibo);
+// Loads the textures of materials added since the last call; materials that use the same
+// image share one texture.
+void loadMaterialTextures() {
+    for (size_t i = materialTex.size(); i < materials.size(); ++i) {
+        const Material& mat = materials.list[i];
+        GLuint t = mat.texPath.empty() ? 0 : textures.acquire(assets, mat.texPath);
+        materialTex.push_back(t ? t : whiteTex);
+    }
+}
+
+// Gives back what loadMaterialTextures took for `tex`; a texture no other material uses is
+// deleted.
+void releaseMaterialTextures(std::vector<GLuint>& tex) {
+    for (GLuint t : tex) if (t != whiteTex) textures.release(t);
+    tex.clear();
+}
+
+// Uploads a loaded mesh and builds its draws, replacing whatever was drawn before.
+void useMesh(const MeshCache& mesh) {
+    vertexFormat = mesh.format;
+    bounds = mesh.bounds;
+    if (bounds.radius <= 0) bounds.radius = 1;
+    printf("Verts: %u, idx: %u, %u bytes/vertex, radius %g\n", mesh.vertexCount, mesh.indexCount, vertexFormat.stride, bounds.radius);
+    buildProgram();
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)mesh.vertexCount*vertexFormat.stride, mesh.vertices, GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size()*sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
-
-    Material& mat = materials.begin()->second;
-    int w,h,comp;
-    unsigned char* data = stbi_load((std::string("asserts/")+mat.texPath).c_str(), &w,&h,&comp,4);
-    if (!data) {
-        printf("Failed to load texture: %s\n", (std::string("asserts/")+mat.texPath).c_str());
-        return false;
-    }
-    glGenTextures(1,&tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,w,h,0,GL_RGBA,GL_UNSIGNED_BYTE,data);
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-    stbi_image_free(data);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount*mesh.indexSize, mesh.indices, GL_STATIC_DRAW);
+    indexSize = mesh.indexSize;
+    indexType = indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    // take the new references before dropping the old ones, so shared images stay loaded
+    std::vector<GLuint> previous;
+    previous.swap(materialTex);
+    loadMaterialTextures();
+    releaseMaterialTextures(previous);
+
+    meshlets = mesh.meshlets;
+    lods = mesh.lods;
+    draws.clear();
+    size_t nextMeshlet = 0;
+    for (uint32_t s = 0, lod = 0; s < mesh.submeshes.size(); ++s) {
+        const SubMesh& sm = mesh.submeshes[s];
+        while (lod + 1 < lods.size() && s >= lods[lod + 1].firstSubmesh) ++lod;
+        Draw d = {lod, whiteTex, {1,1,1}, sm.firstIndex, sm.count, sm.baseVertex, (unsigned int)nextMeshlet, 0};
+        while (nextMeshlet < meshlets.size() && meshlets[nextMeshlet].submesh == s) { ++nextMeshlet; ++d.meshletCount; }
+        if (sm.material >= 0) {
+            d.tex = materialTex[sm.material];
+            memcpy(d.kd, materials.list[sm.material].kd, sizeof(d.kd));
+        }
+        draws.push_back(d);
+    }
+    std::stable_sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) {
+        if (a.lod != b.lod) return a.lod < b.lod;
+        return a.tex != b.tex ? a.tex < b.tex : a.baseVertex < b.baseVertex;
+    });
+}
 
-    glUseProgram(program);
-    glUniform1i(glGetUniformLocation(program, "tex"), 0);
+// Matches the flags CI bakes cube.wglmesh with.
+PrepareOptions meshPrepareOptions() {
+    PrepareOptions prep;
+    prep.lods = true;
+    prep.quantize = true;
+    prep.compress = true;
+    return prep;
+}
+
+// Appends bytes [from, to) of `data` to `buffer`. A full buffer is reallocated at twice the
+// size and gets everything up to `to` again.
+void appendToBuffer(GLenum target, GLuint buffer, size_t& capacity, const void* data, size_t from, size_t to) {
+    glBindBuffer(target, buffer);
+    if (to > capacity) {
+        capacity = std::max(to, capacity * 2);
+        glBufferData(target, capacity, nullptr, GL_DYNAMIC_DRAW);
+        from = 0;
+    }
+    if (to > from) glBufferSubData(target, from, to - from, (const char*)data + from);
+}
+
+// Fetched bytes arrive in pieces where the browser streams them and all at once otherwise.
+// A piece that does not start where the last one ended fails the load, rather than parsing
+// and showing a file with a hole in it.
+void onStreamProgress(emscripten_fetch_t* fetch) {
+    if (!streamLoad || streamLoad->failed || !fetch->data || !fetch->numBytes) return;
+    if (fetch->dataOffset != streamLoad->bytes.size()) {
+        printf("Failed to stream %s: got bytes from %llu, expected %zu\n", fetch->url, (unsigned long long)fetch->dataOffset, streamLoad->bytes.size());
+        streamLoad->failed = true;
+        return;
+    }
+    streamLoad->bytes.insert(streamLoad->bytes.end(), fetch->data, fetch->data + fetch->numBytes);
+}
+
+void onStreamSuccess(emscripten_fetch_t* fetch) {
+    if (streamLoad && !streamLoad->failed) {
+        if (streamLoad->bytes.empty() && fetch->data) streamLoad->bytes.assign(fetch->data, fetch->data + fetch->numBytes);
+        streamLoad->received = true;
+    }
+    emscripten_fetch_close(fetch);
+}
+
+void onStreamError(emscripten_fetch_t* fetch) {
+    printf("Failed to fetch %s: HTTP %d\n", fetch->url, fetch->status);
+    if (streamLoad) streamLoad->failed = true;
+    emscripten_fetch_close(fetch);
+}
+
+void startStreamLoad(const char* url) {
+    materials.clear();
+    releaseMaterialTextures(materialTex);
+    draws.clear();
+    meshlets.clear();
+    lods.clear();
+    streamLoad.reset(new StreamLoad);
+    vertexFormat = floatVertexFormat();
+    indexSize = 2;
+    indexType = GL_UNSIGNED_SHORT;
+    bounds = MeshBounds();
+    bounds.radius = 1;
+    buildProgram();
+
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    strcpy(attr.requestMethod, "GET");
+    attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_STREAM_DATA;
+    attr.onprogress = onStreamProgress;
+    attr.onsuccess = onStreamSuccess;
+    attr.onerror = onStreamError;
+    emscripten_fetch(&attr, url);
+}
+
+// Parses the next slice of what has arrived and uploads and draws the triangles it added.
+void pumpStreamLoad() {
+    StreamLoad& s = *streamLoad;
+    if (s.failed) {
+        draws.clear();
+        streamLoad.reset();
+        return;
+    }
+    size_t n = std::min(kStreamBytesPerFrame, s.bytes.size() - s.fed);
+    if (n) {
+        s.parser.feed(s.bytes.data() + s.fed, n);
+        s.fed += n;
+    }
+    if (s.received && s.fed == s.bytes.size()) {
+        // no LODs here: simplifying takes longer than the rest of prepareMesh on the main thread
+        PrepareOptions prep = meshPrepareOptions();
+        prep.lods = false;
+        MeshCache cache;
+        Mesh mesh = s.parser.finish();
+        StatClock clock;
+        cacheMesh(cache, std::move(mesh), materials, 0, nullptr, prep, &s.stats);
+        s.stats.totalMs += clock.lap();
+        LoadStats stats = s.stats;
+        streamLoad.reset();
+        useMesh(cache);
+        if (kLoadStats) printLoadStats(stats);
+        return;
+    }
+    if (!n) return;
+
+    const Mesh& mesh = s.parser.mesh();
+    const size_t stride = ObjLayoutPUN::kFloats * sizeof(float);
+    appendToBuffer(GL_ARRAY_BUFFER, vbo, s.vboBytes, mesh.vertices.data(), s.uploadedVertices * stride, mesh.vertices.size() * sizeof(float));
+    s.uploadedVertices = mesh.vertices.size() / ObjLayoutPUN::kFloats;
+    loadMaterialTextures();
+
+    // One draw per run of triangles with the same material whose vertices lie within 16 bits
+    // of the run's base, in file order. A base half a window below the first triangle leaves
+    // room both for new vertices and for welded ones from before. A triangle whose corners
+    // are further apart than that waits for finish(), which splits the mesh properly.
+    size_t uploaded = s.indices.size();
+    for (size_t t = s.drawnTriangles; t < mesh.faceMat.size(); ++t) {
+        const unsigned int* tri = &mesh.indices[t*3];
+        unsigned int lo = std::min({tri[0], tri[1], tri[2]}), hi = std::max({tri[0], tri[1], tri[2]});
+        if (hi - lo >= kMaxVertices16) continue;
+        int m = mesh.faceMat[t];
+        if (m != s.lastMaterial || lo < draws.back().baseVertex || hi - draws.back().baseVertex >= kMaxVertices16) {
+            unsigned int base = std::min(lo, hi > kMaxVertices16 / 2 ? hi - (unsigned int)kMaxVertices16 / 2 : 0);
+            Draw d = {0, whiteTex, {1,1,1}, (unsigned int)s.indices.size(), 0, base, 0, 0};
+            if (m >= 0) {
+                d.tex = materialTex[m];
+                memcpy(d.kd, materials.list[m].kd, sizeof(d.kd));
+            }
+            draws.push_back(d);
+            s.lastMaterial = m;
+        }
+        for (int k = 0; k < 3; ++k) s.indices.push_back((uint16_t)(tri[k] - draws.back().baseVertex));
+        draws.back().count += 3;
+    }
+    s.drawnTriangles = mesh.faceMat.size();
+    appendToBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo, s.iboBytes, s.indices.data(), uploaded * sizeof(uint16_t), s.indices.size() * sizeof(uint16_t));
+
+    bounds = s.parser.bounds();
+    if (bounds.radius <= 0) bounds.radius = 1;
+}
+
+bool init(){
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION,2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+    window = SDL_CreateWindow("Obj+Mtl Loader", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, kWidth,kHeight, SDL_WINDOW_OPENGL);
+    glContext = SDL_GL_CreateContext(window);
+    glViewport(0,0,kWidth,kHeight);
+
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(1.0f, 0.1f, 0.1f, 1.0f);
+
+    const unsigned char white[4] = {255,255,255,255};
+    whiteTex = createTexture(1, 1, white);
+    glGenBuffers(1,&vbo);
+    glGenBuffers(1,&ibo);
 
+    // without the baked cache, the OBJ is fetched next to the page and drawn as it loads
+    MeshCache mesh;
+    LoadStats loadStats;
+    if (!loadMeshCached(mesh, "asserts/cube.obj", "asserts/", "asserts/cube.wglmesh", materials, meshPrepareOptions(), meshLoadOptions(), &loadStats)) {
+        printf("No mesh cache, streaming asserts/cube.obj\n");
+        startStreamLoad("asserts/cube.obj");
+        return true;
+    }
+    useMesh(mesh);
+    if (kLoadStats) printLoadStats(loadStats);
     return true;
 }
 
+// WebGL1 has no base-vertex draws, so a range's base vertex goes into the attribute offsets.
+void bindVertexAttribs(unsigned int baseVertex){
+    const VertexFormat& f = vertexFormat;
+    size_t base = (size_t)baseVertex*f.stride;
+    const VertexAttrib* attribs[3] = {&f.position, &f.uv, &f.normal};
+    for (GLuint i = 0; i < 3; ++i) {
+        const VertexAttrib& a = *attribs[i];
+        glVertexAttribPointer(i, a.components, a.type, a.normalized ? GL_TRUE : GL_FALSE, f.stride, (void*)(base + a.offset));
+    }
+}
+
 void render(){
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (draws.empty()) {
+        SDL_GL_SwapWindow(window);
+        return;
+    }
 
     glUseProgram(program);
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)0);
-
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)(3*sizeof(float)));
-
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2,3,GL_FLOAT,GL_FALSE,8*sizeof(float),(void*)(5*sizeof(float)));
 
-    glUniform1f(glGetUniformLocation(program,"rotX"),rotX);
-    glUniform1f(glGetUniformLocation(program,"rotY"),rotY);
+    // The camera looks down -z at the bounding sphere's center, from the distance where
+    // the sphere just fills the vertical field of view; zoom moves it closer.
+    const float* c = bounds.center;
+    float r = bounds.radius;
+    float dist = r / sinf(kFovY * 0.5f) / zoom;
+    float zNear = std::max(dist - r, dist * 0.01f), zFar = dist + r;
+    Mat4 rot = rotation(rotX, rotY);
+    const float negCenter[3] = {-c[0], -c[1], -c[2]}, one[3] = {1,1,1}, back[3] = {0, 0, -dist};
+    Mat4 clipFromObject = perspective(kFovY, (float)kWidth / kHeight, zNear, zFar) * scaleTranslate(one, back) * rot * scaleTranslate(one, negCenter);
+    Mat4 mvp = clipFromObject * scaleTranslate(vertexFormat.posScale, vertexFormat.posOffset);
+    const float normalMat[9] = {rot.m[0], rot.m[1], rot.m[2], rot.m[4], rot.m[5], rot.m[6], rot.m[8], rot.m[9], rot.m[10]};
+    glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, mvp.m);
+    glUniformMatrix3fv(normalMatLoc, 1, GL_FALSE, normalMat);
+
+    // Pixels per object unit at the nearest point of the sphere.
+    float pixelsPerUnit = kHeight * 0.5f / (tanf(kFovY * 0.5f) * zNear);
+    unsigned int lod = (unsigned int)selectLod(lods, pixelsPerUnit);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    // Object-space eye: the center moved back along the inverse rotation of view +z.
+    const float eye[3] = {c[0] + dist*rot.m[2], c[1] + dist*rot.m[6], c[2] + dist*rot.m[10]};
 
-    glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+    glActiveTexture(GL_TEXTURE0);
+    GLuint bound = 0;
+    unsigned int boundBase = ~0u;
+    for (const Draw& d : draws) {
+        if (d.lod != lod) continue;
+        if (d.tex != bound) {
+            glBindTexture(GL_TEXTURE_2D, d.tex);
+            bound = d.tex;
+        }
+        if (d.baseVertex != boundBase) {
+            bindVertexAttribs(d.baseVertex);
+            boundBase = d.baseVertex;
+        }
+        glUniform3fv(kdLoc, 1, d.kd);
+        if (d.meshletCount == 0) {
+            glDrawElements(GL_TRIANGLES, d.count, indexType, (void*)(size_t)(d.firstIndex*indexSize));
+            continue;
+        }
+        // neighbouring meshlets are adjacent in the index buffer, so visible runs merge
+        unsigned int first = 0, count = 0;
+        for (unsigned int i = d.firstMeshlet; i < d.firstMeshlet + d.meshletCount; ++i) {
+            const Meshlet& m = meshlets[i];
+            if (meshletBackfacingFrom(m, eye) || sphereOutside(clipFromObject, m.center, m.radius)) continue;
+            if (count && first + count == m.firstIndex) { count += m.count; continue; }
+            if (count) glDrawElements(GL_TRIANGLES, count, indexType, (void*)(size_t)(first*indexSize));
+            first = m.firstIndex;
+            count = m.count;
+        }
+        if (count) glDrawElements(GL_TRIANGLES, count, indexType, (void*)(size_t)(first*indexSize));
+    }
 
     SDL_GL_SwapWindow(window);
 }
@@ -155,7 +518,11 @@ void render(){
 void loop(){
     SDL_Event e;
     while(SDL_PollEvent(&e)){
-        if (e.type == SDL_QUIT) emscripten_cancel_main_loop();
+        if (e.type == SDL_QUIT) {
+            releaseMaterialTextures(materialTex); // while the context is still there
+            draws.clear();
+            emscripten_cancel_main_loop();
+        }
         else if(e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT){
             mouseDown = true; lastX = e.button.x; lastY = e.button.y;
         } else if(e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT){
@@ -164,8 +531,11 @@ void loop(){
             rotY += (e.motion.x - lastX) * 0.01f;
             rotX += (e.motion.y - lastY) * 0.01f;
             lastX = e.motion.x; lastY = e.motion.y;
+        } else if(e.type == SDL_MOUSEWHEEL){
+            zoom = std::min(std::max(zoom * (e.wheel.y > 0 ? 1.1f : 1/1.1f), 0.05f), 2.5f);
         }
     }
+    if (streamLoad) pumpStreamLoad();
     render();
 }
 
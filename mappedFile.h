@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file: mmap where the platform has it, a plain read otherwise.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+    explicit MappedFile(const char* path) { open(path); }
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) {
+            close();
+            data = o.data; size = o.size; ok = o.ok; mapped = o.mapped;
+            fallback = std::move(o.fallback);
+            if (!mapped && ok) data = size ? fallback.data() : "";
+            o.data = nullptr; o.size = 0; o.ok = false; o.mapped = false;
+        }
+        return *this;
+    }
+
+    explicit operator bool() const { return ok; }
+
+    bool open(const char* path) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            size = (size_t)st.st_size;
+            if (size == 0) { data = ""; ok = true; }
+            else {
+                void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) { data = (const char*)p; mapped = ok = true; }
+            }
+        }
+        ::close(fd);
+        if (ok) return true;
+#endif
+        FILE* f = fopen(path, "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        fallback.resize(len > 0 ? (size_t)len : 0);
+        size = fread(fallback.data(), 1, fallback.size(), f);
+        fclose(f);
+        data = size ? fallback.data() : "";
+        ok = true;
+        return true;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (mapped) munmap((void*)data, size);
+#endif
+        fallback.clear();
+        data = nullptr; size = 0; ok = false; mapped = false;
+    }
+
+private:
+    bool ok = false;
+    bool mapped = false;
+    std::vector<char> fallback;
+};
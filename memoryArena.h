@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+// Forwards to `upstream` and counts what passes through. Every call is made under a lock,
+// so it also makes a monotonic_buffer_resource safe to share between loader threads.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) : upstream(upstream) {}
+
+    size_t bytes() const { return total; }         // everything ever allocated
+    size_t peakBytes() const { return peak; }      // most allocated at once
+    size_t allocations() const { return count; }
+
+private:
+    std::pmr::memory_resource* upstream;
+    std::mutex lock;
+    size_t total = 0, live = 0, peak = 0, count = 0;
+
+    void* do_allocate(size_t bytes, size_t align) override {
+        std::lock_guard<std::mutex> guard(lock);
+        void* p = upstream->allocate(bytes, align);
+        total += bytes;
+        live += bytes;
+        peak = live > peak ? live : peak;
+        ++count;
+        return p;
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        std::lock_guard<std::mutex> guard(lock);
+        upstream->deallocate(p, bytes, align);
+        live -= bytes;
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+};
+
+// What one load took from its arena, see ObjLoadOptions::arenaStats.
+struct ArenaStats {
+    size_t requested = 0;   // bytes the temporaries asked for; an arenaBytes this large never grows
+    size_t allocations = 0;
+    size_t reserved = 0;    // bytes the arena took from ObjLoadOptions::memory
+};
@@ -0,0 +1,363 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "contentHash.h"
+#include "loadObjMtl.h"
+#include "mappedFile.h"
+#include "meshCodec.h"
+#include "meshPipeline.h"
+#include "meshQuant.h"
+
+// .wglmesh: the GPU-ready result of loadObjMtl + prepareMesh, stored so it can be mapped
+// and uploaded without parsing. Little endian, every section starts on a 4-byte boundary:
+//   MeshCacheHeader
+//   VertexFormat describing the vertex section
+//   materialCount x { float kd[3]; u32 nameLen; u32 texLen; name; texPath; pad }, in id order
+//   submeshCount x { i32 material; u32 firstIndex; u32 count; u32 baseVertex }
+//   meshletCount x Meshlet
+//   lodCount x MeshLod
+//   vertexCount * vertexStride bytes, either floatVertexFormat or quantizeVertices output
+//   indexCount indices of indexSize bytes (2 when every submesh fits 16-bit indices)
+// With kMeshCacheCompressed the last two sections hold encodeVertexBuffer and
+// encodeIndexBuffer output instead and run to the next section / the end of the file.
+struct MeshCacheHeader {
+    char magic[4];            // "WGLM"
+    uint32_t version;
+    uint64_t sourceHash;      // contentHash of the OBJ and its MTL files
+    uint32_t vertexStride;
+    uint32_t indexSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t materialCount;
+    uint32_t submeshCount;
+    uint32_t submeshOffset;   // byte offsets from the start of the file
+    uint32_t vertexOffset;
+    uint32_t indexOffset;
+    MeshBounds bounds;
+    uint32_t meshletCount;
+    uint32_t meshletOffset;
+    uint32_t lodCount;
+    uint32_t lodOffset;
+    uint32_t flags;
+};
+static_assert(sizeof(MeshCacheHeader) == 112, "MeshCacheHeader layout");
+static_assert(sizeof(Meshlet) == 44, "Meshlet layout");
+static_assert(sizeof(MeshLod) == 12, "MeshLod layout");
+static_assert(sizeof(MeshBounds) == 40, "MeshBounds layout");
+
+const uint32_t kMeshCacheVersion = 8;
+const uint32_t kMeshCacheCompressed = 1; // MeshCacheHeader::flags
+
+// What the renderer needs to upload a mesh; points either into a mapped cache file, into
+// the decoded copies when the cache was compressed or read from a buffer, or into `owned`
+// when the mesh had to be parsed and the cache could not be written.
+struct MeshCache {
+    MappedFile file;
+    Mesh owned;
+    std::vector<uint8_t> ownedVertices, ownedIndices;
+    VertexFormat format = floatVertexFormat();
+    const void* vertices = nullptr;
+    const void* indices = nullptr;
+    uint32_t indexSize = 4;
+    uint32_t vertexCount = 0, indexCount = 0;
+    std::vector<SubMesh> submeshes;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> lods;
+    MeshBounds bounds;
+};
+
+// Hash of the OBJ bytes, every MTL file it references and the prepareMesh settings.
+inline uint64_t objSourceHash(std::string_view obj, const FileResolver& resolve, const PrepareOptions& prep = {}, const ObjLoadOptions& load = {}) {
+    uint64_t h = contentHash(obj.data(), obj.size(), prep.key() ^ load.key());
+    for (size_t at = obj.find("mtllib"); at != std::string_view::npos; at = obj.find("mtllib", at + 6)) {
+        // only where the parser sees it: the first token of a line, blanks before allowed
+        size_t start = at;
+        while (start > 0 && objscan::isBlank(obj[start-1])) --start;
+        if (start > 0 && obj[start-1] != '\n') continue;
+        if (at + 6 < obj.size() && !objscan::isBlank(obj[at+6]) && obj[at+6] != '\n') continue;
+        const char* p = obj.data() + at + 6;
+        const char* eol = objtext::lineEnd(p, obj.data() + obj.size());
+        ResolvedFile mtl = resolve(objtext::token(p, eol));
+        if (mtl) h = contentHash(mtl.data, mtl.size, h);
+    }
+    return h;
+}
+
+inline uint64_t objSourceHash(const char* data, size_t size, const char* baseDir, const PrepareOptions& prep = {}, const ObjLoadOptions& load = {}) {
+    return objSourceHash(std::string_view(data, size), fileResolver(baseDir), prep, load);
+}
+
+// With `quantized` its vertex bytes are stored instead of the mesh's floats; `compress`
+// encodes the vertex and index sections, see meshCodec.h.
+inline bool writeMeshCache(const char* path, const Mesh& mesh, const MaterialLib& materials, uint64_t sourceHash,
+                           const QuantizedVertices* quantized = nullptr, bool compress = false) {
+    std::vector<char> out(sizeof(MeshCacheHeader));
+    VertexFormat format = quantized ? quantized->format : floatVertexFormat();
+    auto put = [&](const void* p, size_t n) { out.insert(out.end(), (const char*)p, (const char*)p + n); };
+    auto align = [&] { out.resize((out.size() + 3) & ~size_t(3)); };
+
+    put(&format, sizeof(format));
+    for (const Material& mat : materials.list) {
+        uint32_t len[2] = {(uint32_t)mat.name.size(), (uint32_t)mat.texPath.size()};
+        put(mat.kd, sizeof(mat.kd));
+        put(len, sizeof(len));
+        put(mat.name.data(), mat.name.size());
+        put(mat.texPath.data(), mat.texPath.size());
+        align();
+    }
+
+    MeshCacheHeader h = {};
+    memcpy(h.magic, "WGLM", 4);
+    h.version = kMeshCacheVersion;
+    h.sourceHash = sourceHash;
+    h.vertexStride = format.stride;
+    h.vertexCount = (uint32_t)(mesh.vertices.size() / ObjLayoutPUN::kFloats);
+    h.indexCount = (uint32_t)mesh.indices.size();
+    h.materialCount = (uint32_t)materials.size();
+    h.submeshCount = (uint32_t)mesh.submeshes.size();
+    h.submeshOffset = (uint32_t)out.size();
+    for (const SubMesh& sm : mesh.submeshes) {
+        int32_t v[4] = {sm.material, (int32_t)sm.firstIndex, (int32_t)sm.count, (int32_t)sm.baseVertex};
+        put(v, sizeof(v));
+    }
+    h.meshletCount = (uint32_t)mesh.meshlets.size();
+    h.meshletOffset = (uint32_t)out.size();
+    put(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+    h.lodCount = (uint32_t)mesh.lods.size();
+    h.lodOffset = (uint32_t)out.size();
+    put(mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+    h.bounds = mesh.bounds;
+    h.flags = compress ? kMeshCacheCompressed : 0;
+    h.vertexOffset = (uint32_t)out.size();
+    const void* vertexData = quantized ? (const void*)quantized->data.data() : mesh.vertices.data();
+    if (compress) {
+        std::vector<uint8_t> encoded = encodeVertexBuffer(vertexData, h.vertexCount, format.stride);
+        put(encoded.data(), encoded.size());
+        align();
+    } else {
+        put(vertexData, (size_t)h.vertexCount * format.stride);
+    }
+    h.indexOffset = (uint32_t)out.size();
+    h.indexSize = mesh.indices16.size() == mesh.indices.size() ? 2 : 4;
+    if (compress) {
+        std::vector<uint8_t> encoded = h.indexSize == 2 ? encodeIndexBuffer(mesh.indices16.data(), mesh.indices16.size())
+                                                        : encodeIndexBuffer(mesh.indices.data(), mesh.indices.size());
+        put(encoded.data(), encoded.size());
+    } else if (h.indexSize == 2) {
+        put(mesh.indices16.data(), mesh.indices16.size() * sizeof(uint16_t));
+    } else {
+        put(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+    }
+    memcpy(out.data(), &h, sizeof(h));
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return fclose(f) == 0 && ok;
+}
+
+// Parses a cache image and points `cache` into it, or into decoded copies when the streams
+// are compressed or `copy` is set. Fails on a truncated, foreign or outdated image, or when
+// `sourceHash` is non-zero and does not match.
+inline bool readMeshCache(MeshCache& cache, const char* data, size_t size, MaterialLib& materials, uint64_t sourceHash, bool copy) {
+    if (size < sizeof(MeshCacheHeader) + sizeof(VertexFormat)) return false;
+    MeshCacheHeader h;
+    VertexFormat format;
+    memcpy(&h, data, sizeof(h));
+    memcpy(&format, data + sizeof(h), sizeof(format));
+    if (memcmp(h.magic, "WGLM", 4) != 0 || h.version != kMeshCacheVersion || (h.indexSize != 2 && h.indexSize != 4)) return false;
+    if (format.stride == 0 || format.stride != h.vertexStride) return false;
+    if (sourceHash && h.sourceHash != sourceHash) return false;
+    if ((h.submeshOffset | h.meshletOffset | h.lodOffset | h.vertexOffset | h.indexOffset) & 3 ||
+        h.submeshOffset + (uint64_t)h.submeshCount * 16 > h.meshletOffset ||
+        h.meshletOffset + (uint64_t)h.meshletCount * sizeof(Meshlet) > h.lodOffset ||
+        h.lodOffset + (uint64_t)h.lodCount * sizeof(MeshLod) > h.vertexOffset ||
+        h.vertexOffset > h.indexOffset || h.indexOffset > size) return false;
+    bool compressed = h.flags & kMeshCacheCompressed;
+    if (!compressed && (h.vertexOffset + (uint64_t)h.vertexCount * h.vertexStride > h.indexOffset ||
+                        h.indexOffset + (uint64_t)h.indexCount * h.indexSize > size)) return false;
+
+    const char* p = data + sizeof(MeshCacheHeader) + sizeof(VertexFormat);
+    const char* end = data + h.submeshOffset;
+    MaterialLib lib;
+    for (uint32_t i = 0; i < h.materialCount; ++i) {
+        Material mat;
+        uint32_t len[2];
+        if (p + sizeof(mat.kd) + sizeof(len) > end) return false;
+        memcpy(mat.kd, p, sizeof(mat.kd)); p += sizeof(mat.kd);
+        memcpy(len, p, sizeof(len)); p += sizeof(len);
+        if (p + len[0] + len[1] > end) return false;
+        mat.name.assign(p, len[0]); p += len[0];
+        mat.texPath.assign(p, len[1]); p += len[1];
+        p = data + ((p - data + 3) & ~ptrdiff_t(3));
+        lib.list[lib.intern(mat.name)] = std::move(mat);
+    }
+    if (lib.size() != h.materialCount) return false; // a name written twice
+
+    std::vector<SubMesh> submeshes(h.submeshCount);
+    for (uint32_t i = 0; i < h.submeshCount; ++i) {
+        int32_t v[4];
+        memcpy(v, data + h.submeshOffset + i * sizeof(v), sizeof(v));
+        submeshes[i] = {v[0], (unsigned int)v[1], (unsigned int)v[2], (unsigned int)v[3]};
+        if (v[0] < -1 || v[0] >= (int32_t)h.materialCount || (uint64_t)submeshes[i].firstIndex + submeshes[i].count > h.indexCount ||
+            (submeshes[i].baseVertex && submeshes[i].baseVertex >= h.vertexCount)) return false;
+    }
+    std::vector<Meshlet> meshlets(h.meshletCount);
+    if (h.meshletCount) memcpy(meshlets.data(), data + h.meshletOffset, meshlets.size() * sizeof(Meshlet));
+    for (const Meshlet& m : meshlets)
+        if (m.submesh >= h.submeshCount || (uint64_t)m.firstIndex + m.count > h.indexCount) return false;
+    std::vector<MeshLod> lods(h.lodCount);
+    if (h.lodCount) memcpy(lods.data(), data + h.lodOffset, lods.size() * sizeof(MeshLod));
+    for (const MeshLod& lod : lods)
+        if ((uint64_t)lod.firstSubmesh + lod.submeshCount > h.submeshCount) return false;
+    const char* vertexData = data + h.vertexOffset;
+    const char* indexData = data + h.indexOffset;
+    if (compressed) {
+        // every index takes at least a byte, so a header cannot make us allocate much more
+        // than the file could decode to
+        size_t vertexBytes = h.indexOffset - h.vertexOffset, indexBytes = size - h.indexOffset;
+        if (minEncodedVertexBytes(h.vertexCount, h.vertexStride) > vertexBytes || h.indexCount > indexBytes) return false;
+        cache.ownedVertices.resize((size_t)h.vertexCount * h.vertexStride);
+        cache.ownedIndices.resize((size_t)h.indexCount * h.indexSize);
+        const uint8_t* v = (const uint8_t*)vertexData;
+        const uint8_t* i = (const uint8_t*)indexData;
+        if (!decodeVertexBuffer(cache.ownedVertices.data(), h.vertexCount, h.vertexStride, v, vertexBytes)) return false;
+        bool ok = h.indexSize == 2 ? decodeIndexBuffer((uint16_t*)cache.ownedIndices.data(), h.indexCount, i, indexBytes)
+                                   : decodeIndexBuffer((uint32_t*)cache.ownedIndices.data(), h.indexCount, i, indexBytes);
+        if (!ok) return false;
+    } else if (copy) {
+        cache.ownedVertices.assign(vertexData, vertexData + (size_t)h.vertexCount * h.vertexStride);
+        cache.ownedIndices.assign(indexData, indexData + (size_t)h.indexCount * h.indexSize);
+    }
+    if (compressed || copy) {
+        vertexData = (const char*)cache.ownedVertices.data();
+        indexData = (const char*)cache.ownedIndices.data();
+    }
+
+    materials = std::move(lib);
+    cache.submeshes = std::move(submeshes);
+    cache.meshlets = std::move(meshlets);
+    cache.lods = std::move(lods);
+
+    cache.format = format;
+    cache.vertices = vertexData;
+    cache.indices = indexData;
+    cache.indexSize = h.indexSize;
+    cache.vertexCount = h.vertexCount;
+    cache.indexCount = h.indexCount;
+    cache.bounds = h.bounds;
+    return true;
+}
+
+// Maps a cache file; uncompressed streams are used straight from the mapping.
+inline bool openMeshCache(MeshCache& cache, const char* path, MaterialLib& materials, uint64_t sourceHash = 0) {
+    MappedFile file(path);
+    if (!file || !readMeshCache(cache, file.data, file.size, materials, sourceHash, false)) return false;
+    cache.file = std::move(file);
+    return true;
+}
+
+// Reads a cache image from memory, e.g. one that was downloaded rather than preloaded.
+// Everything is copied or decoded, so `data` can be freed afterwards.
+inline bool openMeshCacheBuffer(MeshCache& cache, const void* data, size_t size, MaterialLib& materials, uint64_t sourceHash = 0) {
+    if (!readMeshCache(cache, (const char*)data, size, materials, sourceHash, true)) return false;
+    cache.file = MappedFile();
+    return true;
+}
+
+// Runs prepareMesh (and quantizeVertices when prep.quantize is set) on a freshly loaded mesh
+// and makes it `cache`'s: written to `cachePath` under `sourceHash` and mapped, or kept in
+// memory when `cachePath` is null or cannot be written.
+inline void cacheMesh(MeshCache& cache, Mesh mesh, const MaterialLib& materials, uint64_t sourceHash, const char* cachePath,
+                      const PrepareOptions& prep = {}, LoadStats* stats = nullptr) {
+    if (!kLoadStats) stats = nullptr;
+    StatClock clock;
+    prepareMesh(mesh, prep);
+    QuantizedVertices quantized;
+    if (prep.quantize) quantized = quantizeVertices(mesh);
+    if (stats) stats->prepareMs += clock.lap();
+    bool written = cachePath && writeMeshCache(cachePath, mesh, materials, sourceHash, prep.quantize ? &quantized : nullptr, prep.compress);
+    if (stats) stats->writeMs += clock.lap();
+    if (written) {
+        MaterialLib reread;
+        if (openMeshCache(cache, cachePath, reread, sourceHash)) return;
+    }
+    cache.owned = std::move(mesh);
+    if (prep.quantize) {
+        cache.ownedVertices = std::move(quantized.data);
+        cache.format = quantized.format;
+        cache.vertices = cache.ownedVertices.data();
+    } else {
+        cache.format = floatVertexFormat();
+        cache.vertices = cache.owned.vertices.data();
+    }
+    bool narrow = cache.owned.indices16.size() == cache.owned.indices.size();
+    cache.indices = narrow ? (const void*)cache.owned.indices16.data() : cache.owned.indices.data();
+    cache.indexSize = narrow ? 2 : 4;
+    cache.vertexCount = (uint32_t)(cache.owned.vertices.size() / ObjLayoutPUN::kFloats);
+    cache.indexCount = (uint32_t)cache.owned.indices.size();
+    cache.submeshes = cache.owned.submeshes;
+    cache.meshlets = cache.owned.meshlets;
+    cache.lods = cache.owned.lods;
+    cache.bounds = cache.owned.bounds;
+}
+
+// Uses `cachePath` when it was built from the current OBJ/MTL contents; otherwise parses
+// the OBJ, runs prepareMesh (and quantizeVertices when prep.quantize is set), rewrites the
+// cache and maps it. If the cache cannot be written the result is kept in memory instead.
+// `obj` is already in memory and `resolve` supplies its MTL files, see fileResolver.h.
+// `load` is what the OBJ is parsed with; like `prep` it goes into the hash. `stats` is
+// added to when built with WGL_LOAD_STATS.
+inline bool loadMeshCached(MeshCache& cache, std::string_view obj, const FileResolver& resolve, const char* cachePath, MaterialLib& materials,
+                           const PrepareOptions& prep = {}, const ObjLoadOptions& load = {}, LoadStats* stats = nullptr) {
+    if (!kLoadStats) stats = nullptr;
+    StatClock clock, start;
+    double totalBefore = stats ? stats->totalMs : 0; // the OBJ loader adds its own part
+    uint64_t hash = objSourceHash(obj, resolve, prep, load);
+    if (stats) stats->hashMs += clock.lap();
+    if (openMeshCache(cache, cachePath, materials, hash)) {
+        if (stats) {
+            stats->cacheMs += clock.lap();
+            stats->totalMs = totalBefore + start.lap();
+            stats->bytesRead += cache.file.size;
+            stats->fromCache = true;
+        }
+        return true;
+    }
+
+    materials.clear();
+    ObjLoadOptions parse = load;
+    parse.stats = stats;
+    Mesh mesh = loadObjMtlBuffer(obj, materials, resolve, parse);
+    cacheMesh(cache, std::move(mesh), materials, hash, cachePath, prep, stats);
+    if (stats) stats->totalMs = totalBefore + start.lap();
+    return true;
+}
+
+// The same for an OBJ on disk, with its MTL files under `baseDir`. Without the OBJ, a cache
+// at `cachePath` is used as it is.
+inline bool loadMeshCached(MeshCache& cache, const char* objPath, const char* baseDir, const char* cachePath, MaterialLib& materials,
+                           const PrepareOptions& prep = {}, const ObjLoadOptions& load = {}, LoadStats* stats = nullptr) {
+    if (!kLoadStats) stats = nullptr;
+    StatClock clock;
+    MappedFile obj(objPath);
+    if (stats) {
+        double ms = clock.lap();
+        stats->mapMs += ms;
+        stats->totalMs += ms;
+    }
+    if (obj) return loadMeshCached(cache, std::string_view(obj.data, obj.size), fileResolver(baseDir), cachePath, materials, prep, load, stats);
+    if (!openMeshCache(cache, cachePath, materials)) return false;
+    if (stats) {
+        double ms = clock.lap();
+        stats->cacheMs += ms;
+        stats->totalMs += ms;
+        stats->bytesRead += cache.file.size;
+        stats->fromCache = true;
+    }
+    return true;
+}
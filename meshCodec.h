@@ -0,0 +1,218 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+// Lossless codecs for the vertex and index streams of a .wglmesh. Both are plain byte
+// formats with no tables, so decoding is a single forward pass.
+namespace meshcodec {
+
+inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+const size_t kVertexBlock = 256; // vertices per block
+const size_t kGroup = 16;        // deltas per bit-width group
+
+// Decodes one group stored at `code`'s width from `src` into `out`: the deltas unpacked,
+// unzigzagged and summed onto `p`. Returns the group's last byte, the next group's `p`.
+// With SSE2 or simd128 the group is a single register: the 2- and 4-bit fields are split
+// with shifts and masks and interleaved back into order, and the running sum is four
+// shifted adds.
+#if defined(__SSE2__) || defined(_M_X64)
+inline uint8_t decodeGroup(uint8_t* out, const uint8_t* src, int code, uint8_t p) {
+    __m128i z = _mm_setzero_si128();
+    if (code == 1) {
+        uint32_t w;
+        memcpy(&w, src, 4);
+        __m128i b = _mm_cvtsi32_si128((int)w), m = _mm_set1_epi8(3);
+        __m128i ab = _mm_unpacklo_epi8(_mm_and_si128(b, m), _mm_and_si128(_mm_srli_epi16(b, 2), m));
+        __m128i cd = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(b, 4), m), _mm_and_si128(_mm_srli_epi16(b, 6), m));
+        z = _mm_unpacklo_epi16(ab, cd);
+    } else if (code == 2) {
+        __m128i b = _mm_loadl_epi64((const __m128i*)src), m = _mm_set1_epi8(15);
+        z = _mm_unpacklo_epi8(_mm_and_si128(b, m), _mm_and_si128(_mm_srli_epi16(b, 4), m));
+    } else if (code == 3) {
+        z = _mm_loadu_si128((const __m128i*)src);
+    }
+    __m128i d = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(z, 1), _mm_set1_epi8(0x7f)),
+                              _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, _mm_set1_epi8(1))));
+    d = _mm_add_epi8(d, _mm_slli_si128(d, 1));
+    d = _mm_add_epi8(d, _mm_slli_si128(d, 2));
+    d = _mm_add_epi8(d, _mm_slli_si128(d, 4));
+    d = _mm_add_epi8(d, _mm_slli_si128(d, 8));
+    d = _mm_add_epi8(d, _mm_set1_epi8((char)p));
+    _mm_storeu_si128((__m128i*)out, d);
+    return out[kGroup - 1];
+}
+#elif defined(__wasm_simd128__)
+inline uint8_t decodeGroup(uint8_t* out, const uint8_t* src, int code, uint8_t p) {
+    v128_t z = wasm_i8x16_splat(0), zero = z;
+    if (code == 1) {
+        v128_t b = wasm_v128_load32_zero(src), m = wasm_i8x16_splat(3);
+        v128_t ab = wasm_i8x16_shuffle(wasm_v128_and(b, m), wasm_v128_and(wasm_u8x16_shr(b, 2), m), 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t cd = wasm_i8x16_shuffle(wasm_u8x16_shr(b, 4), wasm_u8x16_shr(b, 6), 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        z = wasm_i8x16_shuffle(ab, wasm_v128_and(cd, m), 0, 1, 16, 17, 2, 3, 18, 19, 4, 5, 20, 21, 6, 7, 22, 23);
+    } else if (code == 2) {
+        v128_t b = wasm_v128_load64_zero(src);
+        z = wasm_i8x16_shuffle(wasm_v128_and(b, wasm_i8x16_splat(15)), wasm_u8x16_shr(b, 4), 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    } else if (code == 3) {
+        z = wasm_v128_load(src);
+    }
+    v128_t d = wasm_v128_xor(wasm_u8x16_shr(z, 1), wasm_i8x16_neg(wasm_v128_and(z, wasm_i8x16_splat(1))));
+    d = wasm_i8x16_add(d, wasm_i8x16_shuffle(zero, d, 0, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30));
+    d = wasm_i8x16_add(d, wasm_i8x16_shuffle(zero, d, 0, 1, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29));
+    d = wasm_i8x16_add(d, wasm_i8x16_shuffle(zero, d, 0, 1, 2, 3, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27));
+    d = wasm_i8x16_add(d, wasm_i8x16_shuffle(zero, d, 0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23));
+    d = wasm_i8x16_add(d, wasm_i8x16_splat((int8_t)p));
+    wasm_v128_store(out, d);
+    return out[kGroup - 1];
+}
+#else
+inline uint8_t decodeGroup(uint8_t* out, const uint8_t* src, int code, uint8_t p) {
+    if (code == 0) {
+        memset(out, 0, kGroup);
+    } else if (code == 1) {
+        for (size_t i = 0; i < kGroup; i += 4) {
+            uint8_t b = *src++;
+            out[i] = b & 3; out[i+1] = b >> 2 & 3; out[i+2] = b >> 4 & 3; out[i+3] = b >> 6;
+        }
+    } else if (code == 2) {
+        for (size_t i = 0; i < kGroup; i += 2) {
+            uint8_t b = *src++;
+            out[i] = b & 15; out[i+1] = b >> 4;
+        }
+    } else {
+        memcpy(out, src, kGroup);
+    }
+    for (size_t i = 0; i < kGroup; ++i) {
+        uint8_t z = out[i];
+        out[i] = p = (uint8_t)(p + (uint8_t)((z >> 1) ^ -(z & 1)));
+    }
+    return p;
+}
+#endif
+
+} // namespace meshcodec
+
+// Index stream: each index as the zigzagged difference from the one before, written as a
+// little-endian base-128 varint. After optimizeVertexCache and optimizeVertexFetch most
+// differences are small, so the typical index takes one or two bytes instead of two or four.
+template <typename T>
+std::vector<uint8_t> encodeIndexBuffer(const T* indices, size_t count) {
+    std::vector<uint8_t> out;
+    out.reserve(count + count / 4);
+    uint32_t last = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t z = meshcodec::zigzag((int32_t)((uint32_t)indices[i] - last));
+        last = (uint32_t)indices[i];
+        for (; z >= 0x80; z >>= 7) out.push_back((uint8_t)(z | 0x80));
+        out.push_back((uint8_t)z);
+    }
+    return out;
+}
+
+// Fails on truncated or overlong input instead of reading past `size`.
+template <typename T>
+bool decodeIndexBuffer(T* dst, size_t count, const uint8_t* src, size_t size) {
+    const uint8_t* end = src + size;
+    uint32_t last = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t z = 0;
+        for (int shift = 0;; shift += 7) {
+            if (src == end || shift > 28) return false;
+            uint8_t b = *src++;
+            z |= (uint32_t)(b & 0x7f) << shift;
+            if (b < 0x80) break;
+        }
+        last += (uint32_t)meshcodec::unzigzag(z);
+        dst[i] = (T)last;
+    }
+    return src == end;
+}
+
+// Vertex stream, per block of kVertexBlock vertices and per byte of the vertex: the byte's
+// difference from the same byte of the previous vertex, zigzagged, in groups of kGroup.
+// A group is stored with 0, 2, 4 or 8 bits per delta, picked by its largest delta; the
+// 2-bit width codes of a byte lane come first, four to a byte. Quantized or smooth
+// attributes give mostly zero and tiny deltas, which is what the narrow widths are for.
+inline std::vector<uint8_t> encodeVertexBuffer(const void* vertices, size_t count, size_t stride) {
+    using namespace meshcodec;
+    const uint8_t* v = (const uint8_t*)vertices;
+    std::vector<uint8_t> out, prev(stride, 0);
+    out.reserve(count * stride / 2);
+    uint8_t deltas[kVertexBlock];
+    for (size_t base = 0; base < count; base += kVertexBlock) {
+        size_t n = count - base < kVertexBlock ? count - base : kVertexBlock;
+        size_t groups = (n + kGroup - 1) / kGroup;
+        for (size_t k = 0; k < stride; ++k) {
+            memset(deltas, 0, sizeof(deltas));
+            for (size_t i = 0; i < n; ++i) {
+                uint8_t b = v[(base + i)*stride + k];
+                uint8_t d = (uint8_t)(b - prev[k]);
+                deltas[i] = (uint8_t)((d << 1) ^ (uint8_t)((int8_t)d >> 7));
+                prev[k] = b;
+            }
+            size_t header = out.size();
+            out.resize(out.size() + (groups + 3) / 4, 0);
+            for (size_t g = 0; g < groups; ++g) {
+                const uint8_t* d = deltas + g*kGroup;
+                uint8_t top = 0;
+                for (size_t i = 0; i < kGroup; ++i) top |= d[i];
+                int code = top == 0 ? 0 : top < 4 ? 1 : top < 16 ? 2 : 3;
+                out[header + g/4] |= (uint8_t)(code << (2 * (g % 4)));
+                if (code == 1)
+                    for (size_t i = 0; i < kGroup; i += 4) out.push_back((uint8_t)(d[i] | d[i+1] << 2 | d[i+2] << 4 | d[i+3] << 6));
+                else if (code == 2)
+                    for (size_t i = 0; i < kGroup; i += 2) out.push_back((uint8_t)(d[i] | d[i+1] << 4));
+                else if (code == 3)
+                    out.insert(out.end(), d, d + kGroup);
+            }
+        }
+    }
+    return out;
+}
+
+// The fewest bytes `count` vertices can encode to: every group is zero, which leaves one
+// width byte per 64 deltas of each byte lane. Lets a reader reject counts before allocating.
+inline size_t minEncodedVertexBytes(size_t count, size_t stride) {
+    return stride * ((count + 4*meshcodec::kGroup - 1) / (4*meshcodec::kGroup));
+}
+
+// Fails on truncated input; bytes after the encoded stream (such as padding) are ignored.
+// A block is decoded lane by lane with decodeGroup, then written out vertex by vertex.
+inline bool decodeVertexBuffer(void* vertices, size_t count, size_t stride, const uint8_t* src, size_t size) {
+    using namespace meshcodec;
+    uint8_t* v = (uint8_t*)vertices;
+    const uint8_t* end = src + size;
+    std::vector<uint8_t> prev(stride, 0), block(stride * kVertexBlock); // a block, lane after lane
+    for (size_t base = 0; base < count; base += kVertexBlock) {
+        size_t n = count - base < kVertexBlock ? count - base : kVertexBlock;
+        size_t groups = (n + kGroup - 1) / kGroup;
+        for (size_t k = 0; k < stride; ++k) {
+            const uint8_t* header = src;
+            if ((size_t)(end - src) < (groups + 3) / 4) return false;
+            src += (groups + 3) / 4;
+            uint8_t* lane = block.data() + k*kVertexBlock;
+            uint8_t p = prev[k];
+            for (size_t g = 0; g < groups; ++g) {
+                int code = header[g/4] >> (2 * (g % 4)) & 3;
+                size_t bytes = code == 0 ? 0 : code == 1 ? kGroup/4 : code == 2 ? kGroup/2 : kGroup;
+                if ((size_t)(end - src) < bytes) return false;
+                p = decodeGroup(lane + g*kGroup, src, code, p);
+                src += bytes;
+            }
+            prev[k] = lane[n - 1];
+        }
+        uint8_t* out = v + base*stride;
+        for (size_t i = 0; i < n; ++i)
+            for (size_t k = 0; k < stride; ++k) *out++ = block[k*kVertexBlock + i];
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "loadObjMtl.h"
+
+const size_t kMaxVertices16 = 65536; // indices 0..65535
+
+// Fills mesh.indices16 so the mesh can be drawn with GL_UNSIGNED_SHORT, which WebGL1
+// supports without OES_element_index_uint and which halves the index buffer.
+// A mesh that already fits is only narrowed. A larger one is cut into ranges of at most
+// 65536 distinct vertices each: every LOD 0 SubMesh becomes one or more SubMeshes whose
+// vertices are copied into their own contiguous block starting at baseVertex, and
+// indices16 is relative to that base. Coarser LODs only use vertices of LOD 0, so their
+// triangles are grouped by the LOD 0 block that holds all three corners and drawn from
+// it; only triangles spanning blocks get copies of their own. LOD 0 triangles keep their
+// positions and coarser ones stay inside their SubMesh's range. `indices` is rewritten to
+// the new vertex order and stays valid for 32-bit drawing. mesh.lods is renumbered to the
+// new SubMeshes; meshlets are not, so build them afterwards. `stride` is the floats per
+// vertex of the mesh's layout.
+inline void buildIndex16(Mesh& mesh, size_t stride = ObjLayoutPUN::kFloats) {
+    size_t vertexCount = mesh.vertices.size() / stride;
+    mesh.indices16.resize(mesh.indices.size());
+    if (vertexCount <= kMaxVertices16) {
+        for (size_t i = 0; i < mesh.indices.size(); ++i) mesh.indices16[i] = (uint16_t)mesh.indices[i];
+        for (SubMesh& sm : mesh.submeshes) sm.baseVertex = 0;
+        return;
+    }
+
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size() + mesh.vertices.size() / 16);
+    std::vector<SubMesh> parts;
+    std::vector<int> local(vertexCount, -1);
+    std::vector<int> lastCopy(vertexCount, -1); // per vertex, its latest copy
+    std::vector<int> prevCopy;                  // per copy, the copy of the same vertex before it
+    std::vector<unsigned int> used;
+    used.reserve(kMaxVertices16);
+
+    auto startPart = [&](int material, unsigned int first) {
+        for (unsigned int v : used) local[v] = -1;
+        used.clear();
+        parts.push_back({material, first, 0, (unsigned int)(vertices.size() / stride)});
+    };
+    // Indices [first, end) into new parts, copying the vertices each one uses into its block.
+    auto copyRange = [&](int material, unsigned int first, unsigned int end) {
+        startPart(material, first);
+        for (unsigned int i = first; i + 3 <= end; i += 3) {
+            size_t fresh = (local[mesh.indices[i]] < 0) + (local[mesh.indices[i+1]] < 0) + (local[mesh.indices[i+2]] < 0);
+            if (used.size() + fresh > kMaxVertices16) {
+                parts.back().count = i - parts.back().firstIndex;
+                startPart(material, i);
+            }
+            SubMesh& part = parts.back();
+            for (unsigned int k = i; k < i + 3; ++k) {
+                unsigned int v = mesh.indices[k];
+                if (local[v] < 0) {
+                    local[v] = (int)used.size();
+                    used.push_back(v);
+                    vertices.insert(vertices.end(), &mesh.vertices[v*stride], &mesh.vertices[v*stride] + stride);
+                    prevCopy.push_back(lastCopy[v]);
+                    lastCopy[v] = (int)prevCopy.size() - 1;
+                }
+                mesh.indices16[k] = (uint16_t)local[v];
+                mesh.indices[k] = part.baseVertex + local[v];
+            }
+        }
+        parts.back().count = end - parts.back().firstIndex;
+    };
+
+    size_t lod0 = mesh.lods.empty() ? mesh.submeshes.size() : mesh.lods[0].submeshCount;
+    std::vector<uint32_t> firstPart(mesh.submeshes.size() + 1);
+    for (size_t s = 0; s < lod0; ++s) {
+        firstPart[s] = (uint32_t)parts.size();
+        copyRange(mesh.submeshes[s].material, mesh.submeshes[s].firstIndex, mesh.submeshes[s].firstIndex + mesh.submeshes[s].count);
+    }
+
+    // Coarser LODs index those copies. Each triangle takes the copies of its corners that lie
+    // closest together and is sorted, stably, into a bucket by its lowest one; a part then
+    // starts at a bucket and runs until a triangle reaches 65536 past it. Only triangles
+    // whose corners lie further apart than that allows get copies of their own.
+    const unsigned int kBucket = 4096, kSpan = kMaxVertices16 - kBucket;
+    auto nearest = [&](unsigned int v, int to) {
+        int best = lastCopy[v];
+        if (best < 0) return ~0u; // not in LOD 0, so it gets copied
+        for (int c = prevCopy[best]; c >= 0; c = prevCopy[c]) if (std::abs(c - to) < std::abs(best - to)) best = c;
+        return (unsigned int)best;
+    };
+    std::vector<uint32_t> bucketOf, bucketStart, cursor;
+    std::vector<unsigned int> ids, sorted;
+    for (size_t s = lod0; s < mesh.submeshes.size(); ++s) {
+        const SubMesh& sm = mesh.submeshes[s];
+        firstPart[s] = (uint32_t)parts.size();
+        size_t triangles = sm.count / 3, buckets = vertices.size() / stride / kBucket + 2, far = buckets - 1;
+        bucketOf.resize(triangles);
+        ids.resize(triangles * 3);
+        bucketStart.assign(buckets + 1, 0);
+        for (size_t t = 0; t < triangles; ++t) {
+            const unsigned int* tri = &mesh.indices[sm.firstIndex + t*3];
+            unsigned int* id = &ids[t*3];
+            unsigned int best = ~0u;
+            for (int a = lastCopy[tri[0]]; a >= 0; a = prevCopy[a]) {
+                unsigned int pick[3] = {(unsigned int)a, nearest(tri[1], a), nearest(tri[2], a)};
+                unsigned int span = std::max({pick[0], pick[1], pick[2]}) - std::min({pick[0], pick[1], pick[2]});
+                if (span < best) {
+                    best = span;
+                    std::copy(pick, pick + 3, id);
+                }
+            }
+            bucketOf[t] = best < kSpan ? std::min({id[0], id[1], id[2]}) / kBucket : (uint32_t)far;
+            ++bucketStart[bucketOf[t] + 1];
+        }
+        for (size_t b = 0; b < buckets; ++b) bucketStart[b + 1] += bucketStart[b];
+
+        // stable, so each bucket keeps the triangle order the optimizers chose
+        sorted.resize(triangles * 3);
+        cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+        for (size_t t = 0; t < triangles; ++t) {
+            const unsigned int* from = bucketOf[t] == far ? &mesh.indices[sm.firstIndex + t*3] : &ids[t*3];
+            std::copy(from, from + 3, &sorted[cursor[bucketOf[t]]++ * 3]);
+        }
+        std::copy(sorted.begin(), sorted.end(), mesh.indices.begin() + sm.firstIndex);
+
+        unsigned int nearEnd = sm.firstIndex + bucketStart[far] * 3, base = 0;
+        for (unsigned int i = sm.firstIndex; i < nearEnd; i += 3) {
+            unsigned int hi = std::max({mesh.indices[i], mesh.indices[i+1], mesh.indices[i+2]});
+            if (i == sm.firstIndex || hi >= base + kMaxVertices16) {
+                if (i != sm.firstIndex) parts.back().count = i - parts.back().firstIndex;
+                base = std::min({mesh.indices[i], mesh.indices[i+1], mesh.indices[i+2]}) / kBucket * kBucket;
+                parts.push_back({sm.material, i, 0, base});
+            }
+            for (unsigned int k = i; k < i + 3; ++k) mesh.indices16[k] = (uint16_t)(mesh.indices[k] - base);
+        }
+        if (nearEnd != sm.firstIndex) parts.back().count = nearEnd - parts.back().firstIndex;
+        if (nearEnd < sm.firstIndex + sm.count || sm.count == 0) copyRange(sm.material, nearEnd, sm.firstIndex + sm.count);
+    }
+
+    firstPart.back() = (uint32_t)parts.size();
+    for (MeshLod& lod : mesh.lods) {
+        uint32_t first = firstPart[lod.firstSubmesh];
+        lod.submeshCount = firstPart[lod.firstSubmesh + lod.submeshCount] - first;
+        lod.firstSubmesh = first;
+    }
+
+    mesh.vertices.swap(vertices);
+    mesh.submeshes.swap(parts);
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#include "simd4.h"
+
+// Smooth vertex normals for meshes that come without them.
+// Face normals and the final normalization run four (eight with AVX) at a time through
+// simd4.h's SSE, wasm simd128 or scalar F4. Only exact sqrt and division are used, but the
+// backends still round differently (AVX and FMA contraction), so results can differ in the
+// last bit between a native bake and the web build.
+namespace normalgen {
+
+using namespace simd4;
+
+// Normalizes n vectors stored as separate x, y, z arrays in place; a zero vector becomes
+// +z, which is what the loader used to write for every missing normal.
+inline void normalizeSoA(float* x, float* y, float* z, size_t n) {
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+        __m256 len = _mm256_sqrt_ps(len2);
+        __m256 ok = _mm256_cmp_ps(len2, _mm256_setzero_ps(), _CMP_GT_OQ);
+        _mm256_storeu_ps(x + i, _mm256_and_ps(ok, _mm256_div_ps(vx, len)));
+        _mm256_storeu_ps(y + i, _mm256_and_ps(ok, _mm256_div_ps(vy, len)));
+        _mm256_storeu_ps(z + i, _mm256_blendv_ps(_mm256_set1_ps(1), _mm256_div_ps(vz, len), ok));
+    }
+#endif
+    for (; i + 4 <= n; i += 4) {
+        F4 vx = load4(x + i), vy = load4(y + i), vz = load4(z + i);
+        F4 len2 = vx*vx + vy*vy + vz*vz;
+        F4 len = sqrt4(len2);
+        store4(x + i, selectPositive(len2, vx / len, splat(0)));
+        store4(y + i, selectPositive(len2, vy / len, splat(0)));
+        store4(z + i, selectPositive(len2, vz / len, splat(1)));
+    }
+    for (; i < n; ++i) {
+        float len2 = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+        float len = std::sqrt(len2);
+        x[i] = len2 > 0 ? x[i] / len : 0;
+        y[i] = len2 > 0 ? y[i] / len : 0;
+        z[i] = len2 > 0 ? z[i] / len : 1;
+    }
+}
+
+// Unnormalized face normals (twice the area) of triangles [first, last), four at a time.
+// Corners are position ids; a triangle with an id outside [0, posCount) gets a zero normal.
+inline void faceNormals(const float* pos, size_t posCount, const int* corners, size_t first, size_t last, float* fx, float* fy, float* fz) {
+    auto valid = [&](size_t t) {
+        const int* c = corners + t*3;
+        return (size_t)c[0] < posCount && (size_t)c[1] < posCount && (size_t)c[2] < posCount;
+    };
+    float g[9][4];
+    size_t t = first;
+    for (; t + 4 <= last; t += 4) {
+        for (int l = 0; l < 4; ++l)
+            for (int k = 0; k < 3; ++k)
+                for (int a = 0; a < 3; ++a) g[k*3 + a][l] = valid(t + l) ? pos[corners[(t + l)*3 + k]*3 + a] : 0;
+        F4 ax = load4(g[0]), ay = load4(g[1]), az = load4(g[2]);
+        F4 e1x = load4(g[3]) - ax, e1y = load4(g[4]) - ay, e1z = load4(g[5]) - az;
+        F4 e2x = load4(g[6]) - ax, e2y = load4(g[7]) - ay, e2z = load4(g[8]) - az;
+        store4(fx + t, e1y*e2z - e1z*e2y);
+        store4(fy + t, e1z*e2x - e1x*e2z);
+        store4(fz + t, e1x*e2y - e1y*e2x);
+    }
+    for (; t < last; ++t) {
+        fx[t] = fy[t] = fz[t] = 0;
+        if (!valid(t)) continue;
+        const float* a = pos + corners[t*3]*3;
+        const float* b = pos + corners[t*3 + 1]*3;
+        const float* c = pos + corners[t*3 + 2]*3;
+        float e1[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]}, e2[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+        fx[t] = e1[1]*e2[2] - e1[2]*e2[1];
+        fy[t] = e1[2]*e2[0] - e1[0]*e2[2];
+        fz[t] = e1[0]*e2[1] - e1[1]*e2[0];
+    }
+}
+
+// Runs fn(begin, end) over [0, count) on up to `threads` threads.
+template <typename Fn>
+void parallelRanges(size_t count, unsigned threads, Fn fn) {
+    if (threads < 2 || count < 2) { fn((size_t)0, count); return; }
+    std::vector<std::thread> workers;
+    size_t step = (count + threads - 1) / threads;
+    for (size_t b = step; b < count; b += step) workers.emplace_back(fn, b, b + step < count ? b + step : count);
+    fn((size_t)0, step < count ? step : count);
+    for (std::thread& w : workers) w.join();
+}
+
+} // namespace normalgen
+
+enum class NormalWeight { Area, Angle };
+
+// The crease angle the app loads OBJs with and bakeMesh bakes them with, so a baked
+// cache matches what the app would build itself.
+const float kDefaultCreaseAngle = 60;
+
+struct NormalOptions {
+    float creaseAngle = 180;             // degrees; faces further apart than this do not smooth together, 180 smooths everything
+    NormalWeight weight = NormalWeight::Area;
+    unsigned threads = 1;
+    size_t minTrianglesPerThread = 1 << 16;
+    std::pmr::memory_resource* memory = nullptr; // for the temporaries; nullptr = the default resource
+};
+
+// One normal per corner of the triangle list `corners` (position ids, three per triangle),
+// written as x,y,z to `out`. Each corner averages the face normals around its position,
+// weighted by face area or by the corner angle; with a crease angle below 180 only faces
+// within that angle of the corner's own face take part, so hard edges stay hard.
+// Corners that share a position and the same set of faces get bit-identical normals.
+// `out` may be a std::vector or a std::pmr::vector; temporaries come from opt.memory.
+template <typename FloatVector>
+void generateCornerNormals(const float* pos, size_t posCount, const int* corners, size_t cornerCount,
+                           FloatVector& out, const NormalOptions& opt = {}) {
+    using namespace normalgen;
+    using Floats = std::pmr::vector<float>;
+    using Ids = std::pmr::vector<uint32_t>;
+    std::pmr::memory_resource* mem = opt.memory ? opt.memory : std::pmr::get_default_resource();
+    size_t triCount = cornerCount / 3;
+    unsigned threads = (unsigned)std::min<size_t>(opt.threads, triCount / opt.minTrianglesPerThread + 1);
+
+    Floats fx(triCount, mem), fy(triCount, mem), fz(triCount, mem);
+    parallelRanges(triCount, threads, [&](size_t b, size_t e) { faceNormals(pos, posCount, corners, b, e, fx.data(), fy.data(), fz.data()); });
+
+    // weight of each corner's face normal
+    Floats weight(triCount * 3, 1.0f, mem);
+    if (opt.weight == NormalWeight::Angle) {
+        parallelRanges(triCount, threads, [&](size_t b, size_t e) {
+            for (size_t t = b; t < e; ++t) {
+                float len = std::sqrt(fx[t]*fx[t] + fy[t]*fy[t] + fz[t]*fz[t]);
+                for (int k = 0; k < 3 && len > 0; ++k) {
+                    const float* p = pos + corners[t*3 + k]*3;
+                    const float* a = pos + corners[t*3 + (k+1)%3]*3;
+                    const float* c = pos + corners[t*3 + (k+2)%3]*3;
+                    float u[3] = {a[0]-p[0], a[1]-p[1], a[2]-p[2]}, v[3] = {c[0]-p[0], c[1]-p[1], c[2]-p[2]};
+                    float lu = std::sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]), lv = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+                    float d = lu > 0 && lv > 0 ? (u[0]*v[0] + u[1]*v[1] + u[2]*v[2]) / (lu * lv) : 1;
+                    weight[t*3 + k] = std::acos(d < -1 ? -1 : d > 1 ? 1 : d) / len;
+                }
+            }
+        });
+    }
+
+    // corners grouped by position (CSR)
+    Ids start(posCount + 1, 0, mem), byPos(triCount * 3, mem);
+    for (size_t c = 0; c < triCount * 3; ++c) if ((size_t)corners[c] < posCount) ++start[corners[c] + 1];
+    for (size_t p = 0; p < posCount; ++p) start[p + 1] += start[p];
+    {
+        Ids fill(start.begin(), start.end() - 1, mem);
+        for (size_t c = 0; c < triCount * 3; ++c) if ((size_t)corners[c] < posCount) byPos[fill[corners[c]]++] = (uint32_t)c;
+    }
+
+    out.resize(triCount * 9);
+    if (opt.creaseAngle >= 180) {
+        Floats nx(posCount, mem), ny(posCount, mem), nz(posCount, mem);
+        parallelRanges(posCount, threads, [&](size_t b, size_t e) {
+            for (size_t p = b; p < e; ++p) {
+                float x = 0, y = 0, z = 0;
+                for (uint32_t i = start[p]; i < start[p + 1]; ++i) {
+                    uint32_t c = byPos[i], t = c / 3;
+                    x += fx[t] * weight[c]; y += fy[t] * weight[c]; z += fz[t] * weight[c];
+                }
+                nx[p] = x; ny[p] = y; nz[p] = z;
+            }
+            normalizeSoA(nx.data() + b, ny.data() + b, nz.data() + b, e - b);
+        });
+        for (size_t c = 0; c < triCount * 3; ++c) {
+            size_t p = (size_t)corners[c] < posCount ? corners[c] : 0;
+            bool ok = (size_t)corners[c] < posCount;
+            out[c*3] = ok ? nx[p] : 0; out[c*3 + 1] = ok ? ny[p] : 0; out[c*3 + 2] = ok ? nz[p] : 1;
+        }
+        return;
+    }
+
+    float cosCrease = std::cos(opt.creaseAngle * 0.017453292f);
+    Floats nx(triCount * 3, mem), ny(triCount * 3, mem), nz(triCount * 3, mem);
+    parallelRanges(triCount * 3, threads, [&](size_t b, size_t e) {
+        for (size_t c = b; c < e; ++c) {
+            uint32_t t = (uint32_t)(c / 3);
+            float x = 0, y = 0, z = 0;
+            if ((size_t)corners[c] < posCount) {
+                float lt = std::sqrt(fx[t]*fx[t] + fy[t]*fy[t] + fz[t]*fz[t]);
+                for (uint32_t i = start[corners[c]]; i < start[corners[c] + 1]; ++i) {
+                    uint32_t o = byPos[i], s = o / 3;
+                    float ls = std::sqrt(fx[s]*fx[s] + fy[s]*fy[s] + fz[s]*fz[s]);
+                    if (fx[t]*fx[s] + fy[t]*fy[s] + fz[t]*fz[s] < cosCrease * lt * ls) continue;
+                    x += fx[s] * weight[o]; y += fy[s] * weight[o]; z += fz[s] * weight[o];
+                }
+            }
+            nx[c] = x; ny[c] = y; nz[c] = z;
+        }
+        normalizeSoA(nx.data() + b, ny.data() + b, nz.data() + b, e - b);
+    });
+    for (size_t c = 0; c < triCount * 3; ++c) { out[c*3] = nx[c]; out[c*3 + 1] = ny[c]; out[c*3 + 2] = nz[c]; }
+}
@@ -0,0 +1,381 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "loadObjMtl.h"
+
+// Post-transform vertex cache statistics for an index buffer, simulated with a FIFO of
+// `cacheSize` entries. ACMR is transformed vertices per triangle (0.5 is the ideal for a
+// regular grid, 3 is no reuse at all), ATVR is transformed vertices per distinct vertex
+// (1 is ideal).
+struct VertexCacheStats {
+    size_t transformed = 0;
+    float acmr = 0;
+    float atvr = 0;
+};
+
+inline VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16) {
+    VertexCacheStats st;
+    std::vector<unsigned int> fifo(cacheSize, ~0u);
+    std::vector<char> seen(vertexCount, 0);
+    size_t head = 0, distinct = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int v = indices[i];
+        bool hit = false;
+        for (unsigned int k = 0; k < cacheSize; ++k) if (fifo[k] == v) { hit = true; break; }
+        if (!hit) {
+            fifo[head] = v;
+            head = (head + 1) % cacheSize;
+            ++st.transformed;
+        }
+        if (!seen[v]) { seen[v] = 1; ++distinct; }
+    }
+    st.acmr = indexCount ? (float)st.transformed / (indexCount / 3) : 0;
+    st.atvr = distinct ? (float)st.transformed / distinct : 0;
+    return st;
+}
+
+// Index count of the full-detail mesh; LOD index lists follow it, see buildLods. The Mesh
+// overloads of the analyzers below only look at this part.
+inline size_t baseIndexCount(const Mesh& mesh) {
+    return mesh.lods.size() < 2 ? mesh.indices.size() : mesh.submeshes[mesh.lods[1].firstSubmesh].firstIndex;
+}
+
+inline VertexCacheStats analyzeVertexCache(const Mesh& mesh, unsigned int cacheSize = 16) {
+    return analyzeVertexCache(mesh.indices.data(), baseIndexCount(mesh), mesh.vertices.size() / ObjLayoutPUN::kFloats, cacheSize);
+}
+
+// Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": greedily emits the triangle
+// whose vertices score best, where a vertex scores high when it is recently used (modelled
+// LRU cache) and when few of its triangles are left. Reorders triangles in place; the
+// set of triangles and their winding do not change.
+namespace forsyth {
+
+const int kCacheSize = 32;
+const int kMaxValence = 32;
+
+inline float vertexScore(int cachePos, unsigned int remaining) {
+    // built once, thread-safely, on first use
+    static const auto table = [] {
+        std::array<std::array<float, kMaxValence + 1>, kCacheSize + 1> t;
+        for (int c = 0; c <= kCacheSize; ++c)
+            for (int r = 0; r <= kMaxValence; ++r) {
+                int pos = c - 1;
+                float s = 0;
+                if (pos >= 0) s = pos < 3 ? 0.75f : std::pow(1.0f - (pos - 3) * (1.0f / (kCacheSize - 3)), 1.5f);
+                t[c][r] = r == 0 ? -1.0f : s + 2.0f / std::sqrt((float)r);
+            }
+        return t;
+    }();
+    return table[cachePos + 1][remaining < (unsigned int)kMaxValence ? remaining : kMaxValence];
+}
+
+} // namespace forsyth
+
+inline void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    using namespace forsyth;
+    size_t triCount = indexCount / 3;
+    if (triCount < 2) return;
+
+    // vertex -> triangles still to be emitted, as CSR
+    std::vector<unsigned int> offset(vertexCount + 1, 0), remaining(vertexCount, 0);
+    for (size_t i = 0; i < triCount * 3; ++i) ++remaining[indices[i]];
+    for (size_t v = 0; v < vertexCount; ++v) offset[v+1] = offset[v] + remaining[v];
+    std::vector<unsigned int> adj(offset[vertexCount]), fill(offset.begin(), offset.end() - 1);
+    for (size_t t = 0; t < triCount; ++t)
+        for (int k = 0; k < 3; ++k) adj[fill[indices[t*3+k]]++] = (unsigned int)t;
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vscore(vertexCount), tscore(triCount);
+    for (size_t v = 0; v < vertexCount; ++v) vscore[v] = vertexScore(-1, remaining[v]);
+    for (size_t t = 0; t < triCount; ++t)
+        tscore[t] = vscore[indices[t*3]] + vscore[indices[t*3+1]] + vscore[indices[t*3+2]];
+
+    std::vector<char> emitted(triCount, 0);
+    std::vector<unsigned int> out(triCount * 3);
+    unsigned int cache[kCacheSize + 3], next[kCacheSize + 3];
+    int cacheCount = 0;
+    size_t cursor = 0;
+
+    long best = 0;
+    for (size_t t = 1; t < triCount; ++t) if (tscore[t] > tscore[best]) best = (long)t;
+
+    for (size_t o = 0; o < triCount; ++o) {
+        if (best < 0) {
+            while (emitted[cursor]) ++cursor;
+            best = (long)cursor;
+        }
+        const unsigned int* tri = &indices[best*3];
+        memcpy(&out[o*3], tri, 3 * sizeof(unsigned int));
+        emitted[best] = 1;
+
+        int nextCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = tri[k];
+            // drop the triangle from the vertex's pending list
+            unsigned int* a = &adj[offset[v]];
+            unsigned int n = remaining[v];
+            for (unsigned int i = 0; i < n; ++i)
+                if (a[i] == (unsigned int)best) { a[i] = a[n-1]; break; }
+            --remaining[v];
+            if (nextCount == 0 || (next[0] != v && (nextCount < 2 || next[1] != v))) next[nextCount++] = v;
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            unsigned int v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) next[nextCount++] = v;
+        }
+        for (int i = kCacheSize; i < nextCount; ++i) cachePos[next[i]] = -1;
+        cacheCount = nextCount < kCacheSize ? nextCount : kCacheSize;
+        memcpy(cache, next, cacheCount * sizeof(unsigned int));
+
+        for (int i = 0; i < nextCount; ++i) {
+            unsigned int v = next[i];
+            cachePos[v] = i < kCacheSize ? i : -1;
+            vscore[v] = vertexScore(cachePos[v], remaining[v]);
+        }
+        // the next triangle is picked among those touching the cache; the rest keep
+        // their relative order and are only reached through the input-order fallback
+        best = -1;
+        float bestScore = -1e30f;
+        for (int i = 0; i < nextCount; ++i) {
+            unsigned int v = next[i];
+            for (unsigned int j = offset[v]; j < offset[v] + remaining[v]; ++j) {
+                unsigned int t = adj[j];
+                const unsigned int* tv = &indices[t*3];
+                tscore[t] = vscore[tv[0]] + vscore[tv[1]] + vscore[tv[2]];
+                if (tscore[t] > bestScore) { bestScore = tscore[t]; best = (long)t; }
+            }
+        }
+    }
+    memcpy(indices, out.data(), out.size() * sizeof(unsigned int));
+}
+
+// Runs the optimizer on every submesh on its own, so material ranges stay intact.
+inline void optimizeVertexCache(Mesh& mesh) {
+    size_t vertexCount = mesh.vertices.size() / ObjLayoutPUN::kFloats;
+    for (const SubMesh& sm : mesh.submeshes)
+        optimizeVertexCache(&mesh.indices[sm.firstIndex], sm.count, vertexCount);
+}
+
+// Vertex fetch statistics: how many bytes a GPU with a small fully associative cache of
+// 64-byte lines reads for the vertex buffer, relative to the size of the vertices that
+// are actually referenced. 1.0 means every referenced byte is read exactly once.
+struct VertexFetchStats {
+    size_t bytesFetched = 0;
+    float overfetch = 0;
+};
+
+inline VertexFetchStats analyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t vertexSize, unsigned int cacheLines = 64) {
+    const size_t kLine = 64;
+    VertexFetchStats st;
+    std::vector<size_t> line(cacheLines, ~size_t(0)), stamp(cacheLines, 0);
+    std::vector<char> seen(vertexCount, 0);
+    size_t distinct = 0, clock = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int v = indices[i];
+        if (!seen[v]) { seen[v] = 1; ++distinct; }
+        size_t first = v * vertexSize / kLine, last = (v * vertexSize + vertexSize - 1) / kLine;
+        for (size_t l = first; l <= last; ++l) {
+            unsigned int hit = cacheLines, lru = 0;
+            for (unsigned int k = 0; k < cacheLines; ++k) {
+                if (line[k] == l) { hit = k; break; }
+                if (stamp[k] < stamp[lru]) lru = k;
+            }
+            if (hit == cacheLines) { hit = lru; line[hit] = l; st.bytesFetched += kLine; }
+            stamp[hit] = ++clock;
+        }
+    }
+    st.overfetch = distinct ? (float)st.bytesFetched / (distinct * vertexSize) : 0;
+    return st;
+}
+
+inline VertexFetchStats analyzeVertexFetch(const Mesh& mesh) {
+    return analyzeVertexFetch(mesh.indices.data(), baseIndexCount(mesh), mesh.vertices.size() / ObjLayoutPUN::kFloats, ObjLayoutPUN::kFloats * sizeof(float));
+}
+
+// Renumbers vertices in the order the index buffer first uses them, so fetches walk the
+// vertex buffer forwards, and drops vertices no triangle references. Triangle order and
+// submesh ranges are untouched; run it before buildIndex16.
+inline void optimizeVertexFetch(Mesh& mesh) {
+    const size_t stride = ObjLayoutPUN::kFloats;
+    size_t vertexCount = mesh.vertices.size() / stride;
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    unsigned int next = 0;
+    for (unsigned int& i : mesh.indices) {
+        if (remap[i] == ~0u) {
+            remap[i] = next++;
+            vertices.insert(vertices.end(), &mesh.vertices[i*stride], &mesh.vertices[i*stride] + stride);
+        }
+        i = remap[i];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+// Overdraw statistics from a small software rasterizer: the mesh is drawn with depth
+// testing and back-face culling from the six axis directions. overdraw is the number of
+// fragments that passed the depth test per covered pixel, averaged over the views;
+// 1.0 means nothing was ever shaded twice.
+struct OverdrawStats {
+    size_t covered = 0;
+    size_t shaded = 0;
+    float overdraw = 0;
+};
+
+inline OverdrawStats analyzeOverdraw(const unsigned int* indices, size_t indexCount, const float* vertices, size_t vertexCount, size_t stride = ObjLayoutPUN::kFloats) {
+    const int kRes = 256;
+    OverdrawStats st;
+    if (!vertexCount) return st;
+    float bmin[3] = {1e30f, 1e30f, 1e30f}, bmax[3] = {-1e30f, -1e30f, -1e30f};
+    for (size_t v = 0; v < vertexCount; ++v)
+        for (int k = 0; k < 3; ++k) {
+            bmin[k] = std::min(bmin[k], vertices[v*stride+k]);
+            bmax[k] = std::max(bmax[k], vertices[v*stride+k]);
+        }
+    float extent = std::max(bmax[0] - bmin[0], std::max(bmax[1] - bmin[1], bmax[2] - bmin[2]));
+    float scale = extent > 0 ? (kRes - 1) / extent : 0;
+
+    std::vector<float> depth(kRes * kRes);
+    std::vector<unsigned char> hit(kRes * kRes);
+    for (int view = 0; view < 6; ++view) {
+        int axis = view >> 1;
+        int ax = (axis + 1) % 3, ay = (axis + 2) % 3;
+        float dir = view & 1 ? -1.0f : 1.0f; // looking along -axis or +axis
+        std::fill(depth.begin(), depth.end(), 1e30f);
+        std::fill(hit.begin(), hit.end(), 0);
+        for (size_t i = 0; i + 3 <= indexCount; i += 3) {
+            float x[3], y[3], z[3];
+            for (int k = 0; k < 3; ++k) {
+                const float* p = &vertices[indices[i+k]*stride];
+                x[k] = (p[ax] - bmin[ax]) * scale;
+                y[k] = (p[ay] - bmin[ay]) * scale;
+                z[k] = -dir * p[axis];
+            }
+            float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (area * dir <= 0) continue; // back-facing or degenerate from this side
+            int x0 = std::max(0, (int)std::ceil(std::min(x[0], std::min(x[1], x[2]))));
+            int x1 = std::min(kRes - 1, (int)std::floor(std::max(x[0], std::max(x[1], x[2]))));
+            int y0 = std::max(0, (int)std::ceil(std::min(y[0], std::min(y[1], y[2]))));
+            int y1 = std::min(kRes - 1, (int)std::floor(std::max(y[0], std::max(y[1], y[2]))));
+            float inv = 1.0f / area;
+            for (int py = y0; py <= y1; ++py)
+                for (int px = x0; px <= x1; ++px) {
+                    float w0 = ((x[2] - x[1]) * (py - y[1]) - (y[2] - y[1]) * (px - x[1])) * inv;
+                    float w1 = ((x[0] - x[2]) * (py - y[2]) - (y[0] - y[2]) * (px - x[2])) * inv;
+                    float w2 = 1.0f - w0 - w1;
+                    if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+                    float d = w0 * z[0] + w1 * z[1] + w2 * z[2];
+                    int at = py * kRes + px;
+                    if (d < depth[at]) {
+                        depth[at] = d;
+                        hit[at] = 1;
+                        ++st.shaded;
+                    }
+                }
+        }
+        for (unsigned char h : hit) st.covered += h;
+    }
+    st.overdraw = st.covered ? (float)st.shaded / st.covered : 0;
+    return st;
+}
+
+inline OverdrawStats analyzeOverdraw(const Mesh& mesh) {
+    return analyzeOverdraw(mesh.indices.data(), baseIndexCount(mesh), mesh.vertices.data(), mesh.vertices.size() / ObjLayoutPUN::kFloats);
+}
+
+// Overdraw reduction after Sander, Nehab and Barczak, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw": the cache-optimized order is cut into clusters
+// wherever cutting costs little vertex reuse (the running ACMR of the cluster is within
+// `threshold` of the whole range's), and the clusters are sorted so the ones facing away
+// from the mesh centre, which tend to occlude the rest, are drawn first. Run it after
+// optimizeVertexCache; it works on each submesh separately.
+inline void optimizeOverdraw(unsigned int* indices, size_t indexCount, const float* vertices, size_t vertexCount, float threshold = 1.05f, size_t stride = ObjLayoutPUN::kFloats) {
+    const unsigned int kCache = 16;
+    size_t triCount = indexCount / 3;
+    if (triCount < 2) return;
+
+    float targetAcmr = analyzeVertexCache(indices, triCount * 3, vertexCount, kCache).acmr * threshold;
+
+    // FIFO simulation restarted at every cluster start
+    std::vector<unsigned int> stampOf(vertexCount, 0);
+    unsigned int time = kCache + 1;
+    auto misses = [&](size_t t) {
+        unsigned int m = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = indices[t*3+k];
+            if (time - stampOf[v] > kCache) { stampOf[v] = time++; ++m; }
+        }
+        return m;
+    };
+
+    std::vector<size_t> starts{0};
+    size_t clusterMisses = 0;
+    for (size_t t = 0; t < triCount; ++t) {
+        unsigned int m = misses(t);
+        // three misses means the cache has no relation to the previous triangle
+        if (m == 3 && t > starts.back()) {
+            starts.push_back(t);
+            clusterMisses = 0;
+            time += kCache + 1;
+            m = misses(t);
+        }
+        clusterMisses += m;
+        size_t len = t + 1 - starts.back();
+        if (t + 1 < triCount && len >= 8 && (float)clusterMisses / len <= targetAcmr) {
+            starts.push_back(t + 1);
+            clusterMisses = 0;
+            time += kCache + 1;
+        }
+    }
+    starts.push_back(triCount);
+
+    float centre[3] = {0,0,0};
+    size_t clusterCount = starts.size() - 1;
+    std::vector<float> cc(clusterCount * 3, 0), cn(clusterCount * 3, 0), carea(clusterCount, 0);
+    float total = 0;
+    for (size_t c = 0; c < clusterCount; ++c)
+        for (size_t t = starts[c]; t < starts[c+1]; ++t) {
+            const float* a = &vertices[indices[t*3]*stride];
+            const float* b = &vertices[indices[t*3+1]*stride];
+            const float* d = &vertices[indices[t*3+2]*stride];
+            float e1[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]}, e2[3] = {d[0]-a[0], d[1]-a[1], d[2]-a[2]};
+            float n[3] = {e1[1]*e2[2]-e1[2]*e2[1], e1[2]*e2[0]-e1[0]*e2[2], e1[0]*e2[1]-e1[1]*e2[0]};
+            float area = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            for (int k = 0; k < 3; ++k) {
+                float mid = (a[k] + b[k] + d[k]) / 3;
+                cc[c*3+k] += mid * area;
+                cn[c*3+k] += n[k];
+                centre[k] += mid * area;
+            }
+            carea[c] += area;
+            total += area;
+        }
+    for (int k = 0; k < 3; ++k) centre[k] = total > 0 ? centre[k] / total : 0;
+
+    std::vector<float> key(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float len = std::sqrt(cn[c*3]*cn[c*3] + cn[c*3+1]*cn[c*3+1] + cn[c*3+2]*cn[c*3+2]);
+        float k = 0;
+        if (carea[c] > 0 && len > 0)
+            for (int j = 0; j < 3; ++j) k += (cc[c*3+j] / carea[c] - centre[j]) * cn[c*3+j] / len;
+        key[c] = k;
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key[a] > key[b]; });
+
+    std::vector<unsigned int> out;
+    out.reserve(triCount * 3);
+    for (size_t c : order) out.insert(out.end(), indices + starts[c]*3, indices + starts[c+1]*3);
+    memcpy(indices, out.data(), out.size() * sizeof(unsigned int));
+}
+
+inline void optimizeOverdraw(Mesh& mesh, float threshold = 1.05f) {
+    size_t vertexCount = mesh.vertices.size() / ObjLayoutPUN::kFloats;
+    for (const SubMesh& sm : mesh.submeshes)
+        optimizeOverdraw(&mesh.indices[sm.firstIndex], sm.count, mesh.vertices.data(), vertexCount, threshold);
+}
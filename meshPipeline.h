@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "loadObjMtl.h"
+#include "meshIndex16.h"
+#include "meshlet.h"
+#include "meshOpt.h"
+#include "meshSimplify.h"
+
+// Bump whenever prepareMesh changes its output, so baked .wglmesh caches get rebuilt.
+const uint32_t kMeshPipelineVersion = 5;
+
+// Which optional stages prepareMesh runs. key() goes into the cache hash.
+struct PrepareOptions {
+    bool lods = false;              // simplified LOD chain, see buildLods; slow, so meant for the offline bake
+    bool vertexCache = true;        // Forsyth triangle order per submesh, see optimizeVertexCache
+    bool overdraw = true;           // cluster reorder, see optimizeOverdraw
+    float overdrawThreshold = 1.05f;
+    bool vertexFetch = true;        // first-use vertex order, see optimizeVertexFetch
+    bool meshlets = true;           // culling clusters, see buildMeshlets
+    bool quantize = false;          // cache the 12-byte layout of quantizeVertices instead of floats
+    bool compress = false;          // encode the cached streams, see meshCodec.h; decodes to the same data, so not in key()
+
+    uint64_t key() const {
+        uint32_t threshold;
+        memcpy(&threshold, &overdrawThreshold, sizeof(threshold));
+        uint64_t flags = (vertexCache ? 1 : 0) | (overdraw ? 2 : 0) | (vertexFetch ? 4 : 0) | (quantize ? 8 : 0) | (meshlets ? 16 : 0) | (lods ? 32 : 0);
+        return ((uint64_t)kMeshPipelineVersion << 48 | flags << 32 | (overdraw ? threshold : 0)) * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+// Post-load stages every mesh goes through before it is cached or uploaded.
+inline void prepareMesh(Mesh& mesh, const PrepareOptions& opt = {}) {
+    if (opt.lods) buildLods(mesh);
+    if (opt.vertexCache) optimizeVertexCache(mesh);
+    if (opt.overdraw) optimizeOverdraw(mesh, opt.overdrawThreshold);
+    if (opt.vertexFetch) optimizeVertexFetch(mesh);
+    buildIndex16(mesh);
+    if (opt.meshlets) buildMeshlets(mesh);
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "loadObjMtl.h"
+
+// Attribute component types, same values as the GL enums so they can be passed through.
+const uint32_t kAttribByte = 0x1400;
+const uint32_t kAttribShort = 0x1402;
+const uint32_t kAttribUnsignedShort = 0x1403;
+const uint32_t kAttribFloat = 0x1406;
+
+struct VertexAttrib {
+    uint32_t type;
+    uint16_t components;
+    uint16_t normalized;
+    uint32_t offset;
+};
+
+// How a vertex buffer is laid out and how the vertex shader turns attributes back into
+// object space: pos = aPos * posScale + posOffset, uv = aUV * uvScale + uvOffset, and
+// with octNormal the normal is two octahedral components scaled by 1/127.
+// Plain POD so it can be copied into the .wglmesh header as is.
+struct VertexFormat {
+    uint32_t stride;
+    uint32_t octNormal;
+    VertexAttrib position, uv, normal;
+    float posScale[3], posOffset[3];
+    float uvScale[2], uvOffset[2];
+};
+static_assert(sizeof(VertexFormat) == 84, "VertexFormat layout");
+
+// The loader's interleaved x,y,z, u,v, nx,ny,nz floats.
+inline VertexFormat floatVertexFormat() {
+    VertexFormat f = {};
+    f.stride = ObjLayoutPUN::kFloats * sizeof(float);
+    f.position = {kAttribFloat, 3, 0, 0};
+    f.uv = {kAttribFloat, 2, 0, 3 * sizeof(float)};
+    f.normal = {kAttribFloat, 3, 0, 5 * sizeof(float)};
+    f.posScale[0] = f.posScale[1] = f.posScale[2] = 1;
+    f.uvScale[0] = f.uvScale[1] = 1;
+    return f;
+}
+
+// 12 bytes per vertex: int16 x,y,z over the mesh AABB, two int8 octahedral normal
+// components, uint16 u,v over the UV range. Attributes are not GL-normalized; the
+// shader applies the scales, which keeps the decode exact under both the ES2 and the
+// ES3 rules for normalized integers.
+inline VertexFormat quantizedVertexFormat() {
+    VertexFormat f = {};
+    f.stride = 12;
+    f.octNormal = 1;
+    f.position = {kAttribShort, 3, 0, 0};
+    f.normal = {kAttribByte, 2, 0, 6};
+    f.uv = {kAttribUnsignedShort, 2, 0, 8};
+    return f;
+}
+
+// Largest differences between the float mesh and what the shader reconstructs.
+struct QuantizationError {
+    float position = 0; // object-space units
+    float normalDeg = 0;
+    float uv = 0;
+};
+
+struct QuantizedVertices {
+    VertexFormat format;
+    std::vector<uint8_t> data;
+    QuantizationError error;
+};
+
+inline void octEncode(const float n[3], int8_t out[2]) {
+    float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    float x = l1 > 0 ? n[0] / l1 : 0, y = l1 > 0 ? n[1] / l1 : 0;
+    if (n[2] < 0) {
+        float ox = x;
+        x = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+        y = (1 - std::fabs(ox)) * (y >= 0 ? 1 : -1);
+    }
+    out[0] = (int8_t)std::lround(std::clamp(x, -1.0f, 1.0f) * 127);
+    out[1] = (int8_t)std::lround(std::clamp(y, -1.0f, 1.0f) * 127);
+}
+
+// Mirrors octDecode in main.cpp's vertex shader.
+inline void octDecode(const int8_t e[2], float n[3]) {
+    n[0] = e[0] / 127.0f;
+    n[1] = e[1] / 127.0f;
+    n[2] = 1 - std::fabs(n[0]) - std::fabs(n[1]);
+    float t = std::max(-n[2], 0.0f);
+    n[0] += n[0] >= 0 ? -t : t;
+    n[1] += n[1] >= 0 ? -t : t;
+    float l = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    for (int k = 0; k < 3; ++k) n[k] = l > 0 ? n[k] / l : 0;
+}
+
+inline QuantizedVertices quantizeVertices(const Mesh& mesh) {
+    const size_t stride = ObjLayoutPUN::kFloats;
+    size_t count = mesh.vertices.size() / stride;
+    QuantizedVertices q;
+    q.format = quantizedVertexFormat();
+    q.data.resize(count * q.format.stride);
+
+    float pmin[3] = {0,0,0}, pmax[3] = {0,0,0}, tmin[2] = {0,0}, tmax[2] = {0,0};
+    for (size_t v = 0; v < count; ++v) {
+        const float* s = &mesh.vertices[v*stride];
+        for (int k = 0; k < 3; ++k) {
+            pmin[k] = v ? std::min(pmin[k], s[k]) : s[k];
+            pmax[k] = v ? std::max(pmax[k], s[k]) : s[k];
+        }
+        for (int k = 0; k < 2; ++k) {
+            tmin[k] = v ? std::min(tmin[k], s[3+k]) : s[3+k];
+            tmax[k] = v ? std::max(tmax[k], s[3+k]) : s[3+k];
+        }
+    }
+    VertexFormat& f = q.format;
+    for (int k = 0; k < 3; ++k) {
+        float half = (pmax[k] - pmin[k]) * 0.5f;
+        f.posOffset[k] = pmin[k] + half;
+        f.posScale[k] = (half > 0 ? half : 1) / 32767.0f;
+    }
+    for (int k = 0; k < 2; ++k) {
+        f.uvOffset[k] = tmin[k];
+        f.uvScale[k] = (tmax[k] > tmin[k] ? tmax[k] - tmin[k] : 1) / 65535.0f;
+    }
+
+    QuantizationError& err = q.error;
+    float minCos = 1;
+    for (size_t v = 0; v < count; ++v) {
+        const float* s = &mesh.vertices[v*stride];
+        uint8_t* d = &q.data[v * f.stride];
+        int16_t pos[3];
+        for (int k = 0; k < 3; ++k) {
+            long qv = std::lround((s[k] - f.posOffset[k]) / f.posScale[k]);
+            pos[k] = (int16_t)std::clamp(qv, -32767L, 32767L);
+            err.position = std::max(err.position, std::fabs(pos[k] * f.posScale[k] + f.posOffset[k] - s[k]));
+        }
+        int8_t oct[2];
+        octEncode(s + 5, oct);
+        uint16_t uv[2];
+        for (int k = 0; k < 2; ++k) {
+            long qv = std::lround((s[3+k] - f.uvOffset[k]) / f.uvScale[k]);
+            uv[k] = (uint16_t)std::clamp(qv, 0L, 65535L);
+            err.uv = std::max(err.uv, std::fabs(uv[k] * f.uvScale[k] + f.uvOffset[k] - s[3+k]));
+        }
+        memcpy(d + f.position.offset, pos, sizeof(pos));
+        memcpy(d + f.normal.offset, oct, sizeof(oct));
+        memcpy(d + f.uv.offset, uv, sizeof(uv));
+
+        float n[3], len = std::sqrt(s[5]*s[5] + s[6]*s[6] + s[7]*s[7]);
+        octDecode(oct, n);
+        if (len > 0) minCos = std::min(minCos, (n[0]*s[5] + n[1]*s[6] + n[2]*s[7]) / len);
+    }
+    err.normalDeg = std::acos(std::clamp(minCos, -1.0f, 1.0f)) * 57.29578f;
+    return q;
+}
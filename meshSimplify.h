@@ -0,0 +1,204 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "loadObjMtl.h"
+
+// Triangle counts of the generated LODs relative to the full mesh, see buildLods.
+const float kLodRatios[] = {0.5f, 0.25f, 0.1f};
+
+namespace qem {
+
+// Garland-Heckbert error quadric: the sum of squared distances to a set of planes, as
+// the upper half of a symmetric 4x4 matrix, weighted by triangle area. `w` is the total
+// weight, which turns eval() into a mean squared distance.
+struct Quadric {
+    double m[10] = {}; // xx xy xz xw yy yz yw zz zw ww
+    double w = 0;
+
+    void addPlane(double a, double b, double c, double d, double weight) {
+        double p[4] = {a, b, c, d};
+        for (int i = 0, k = 0; i < 4; ++i)
+            for (int j = i; j < 4; ++j) m[k++] += weight * p[i] * p[j];
+        w += weight;
+    }
+    void add(const Quadric& q) {
+        for (int k = 0; k < 10; ++k) m[k] += q.m[k];
+        w += q.w;
+    }
+    double eval(const float* p) const {
+        double x = p[0], y = p[1], z = p[2];
+        return m[0]*x*x + 2*m[1]*x*y + 2*m[2]*x*z + 2*m[3]*x
+             + m[4]*y*y + 2*m[5]*y*z + 2*m[6]*y
+             + m[7]*z*z + 2*m[8]*z + m[9];
+    }
+};
+
+inline void triangleNormal(const float* a, const float* b, const float* c, double n[3]) {
+    double e1[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]}, e2[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+    n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+    n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+    n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+}
+
+} // namespace qem
+
+// Quadric edge-collapse simplification of one triangle list down to about `targetIndexCount`
+// indices. Collapses are half-edge (v moves onto a neighbour u), so no new vertices are made
+// and the result indexes the same vertex buffer. A vertex on an edge used by one triangle
+// or by more than two is never moved. Since UV and normal seams split vertices, and since
+// this runs on one material's range at a time, that keeps seams, open borders and material
+// boundaries in place. Collapses that would flip a triangle are rejected. `resultError` gets
+// the largest error of any collapse as an object-space distance.
+inline std::vector<unsigned int> simplifyMesh(const unsigned int* indices, size_t indexCount, const float* vertices, size_t vertexCount,
+                                              size_t targetIndexCount, float* resultError = nullptr, size_t stride = ObjLayoutPUN::kFloats) {
+    using namespace qem;
+    std::vector<unsigned int> out(indices, indices + indexCount - indexCount % 3);
+    std::vector<char> locked(vertexCount, 0);
+    std::unordered_map<uint64_t, int> edges;
+    edges.reserve(out.size());
+    for (size_t i = 0; i < out.size(); i += 3)
+        for (int k = 0; k < 3; ++k) {
+            unsigned int a = out[i+k], b = out[i + (k+1)%3];
+            ++edges[(uint64_t)std::min(a, b) << 32 | std::max(a, b)];
+        }
+    for (const auto& e : edges)
+        if (e.second != 2) locked[e.first >> 32] = locked[e.first & 0xffffffffu] = 1;
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < out.size(); i += 3) {
+        const float* p = &vertices[out[i]*stride];
+        double n[3];
+        triangleNormal(p, &vertices[out[i+1]*stride], &vertices[out[i+2]*stride], n);
+        double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (len == 0) continue;
+        double a = n[0]/len, b = n[1]/len, c = n[2]/len, d = -(a*p[0] + b*p[1] + c*p[2]);
+        for (int k = 0; k < 3; ++k) quadrics[out[i+k]].addPlane(a, b, c, d, len * 0.5);
+    }
+
+    struct Collapse { unsigned int v, u; double cost; };
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> adjOffset(vertexCount + 1), adj, remap(vertexCount);
+    std::vector<char> touched(vertexCount);
+    double maxError = 0;
+    while (out.size() > targetIndexCount) {
+        std::fill(adjOffset.begin(), adjOffset.end(), 0);
+        for (unsigned int v : out) ++adjOffset[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v) adjOffset[v + 1] += adjOffset[v];
+        adj.resize(out.size());
+        std::vector<unsigned int> fill(adjOffset.begin(), adjOffset.end() - 1);
+        for (size_t i = 0; i < out.size(); ++i) adj[fill[out[i]]++] = (unsigned int)(i / 3);
+
+        collapses.clear();
+        for (size_t i = 0; i < out.size(); i += 3)
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = out[i+k], u = out[i + (k+1)%3];
+                if (!locked[v]) collapses.push_back({v, u, 0});
+                if (!locked[u]) collapses.push_back({u, v, 0});
+            }
+        for (Collapse& c : collapses) {
+            Quadric q = quadrics[c.v];
+            q.add(quadrics[c.u]);
+            c.cost = q.eval(&vertices[c.u*stride]);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // each collapse removes about two triangles
+        size_t wanted = (out.size() - targetIndexCount) / 6 + 1, done = 0;
+        for (size_t v = 0; v < vertexCount; ++v) remap[v] = (unsigned int)v;
+        std::fill(touched.begin(), touched.end(), 0);
+        for (const Collapse& c : collapses) {
+            if (done >= wanted) break;
+            if (touched[c.v] || touched[c.u]) continue;
+            // a triangle around v that does not contain u must keep its orientation
+            bool flips = false;
+            for (unsigned int a = adjOffset[c.v]; a < adjOffset[c.v + 1] && !flips; ++a) {
+                const unsigned int* t = &out[adj[a]*3];
+                if (t[0] == c.u || t[1] == c.u || t[2] == c.u) continue;
+                const float* p[3];
+                const float* q[3];
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = &vertices[t[k]*stride];
+                    q[k] = &vertices[(t[k] == c.v ? c.u : t[k])*stride];
+                }
+                double n0[3], n1[3];
+                triangleNormal(p[0], p[1], p[2], n0);
+                triangleNormal(q[0], q[1], q[2], n1);
+                flips = n0[0]*n1[0] + n0[1]*n1[1] + n0[2]*n1[2] <= 0;
+            }
+            if (flips) continue;
+
+            remap[c.v] = c.u;
+            quadrics[c.u].add(quadrics[c.v]);
+            double w = quadrics[c.u].w;
+            maxError = std::max(maxError, w > 0 ? c.cost / w : 0);
+            // the one-ring of v changes shape; keep it fixed for the rest of this pass
+            for (unsigned int a = adjOffset[c.v]; a < adjOffset[c.v + 1]; ++a)
+                for (int k = 0; k < 3; ++k) touched[out[adj[a]*3 + k]] = 1;
+            ++done;
+        }
+        if (!done) break;
+
+        size_t n = 0;
+        for (size_t i = 0; i < out.size(); i += 3) {
+            unsigned int a = remap[out[i]], b = remap[out[i+1]], c = remap[out[i+2]];
+            if (a == b || b == c || a == c) continue;
+            out[n++] = a; out[n++] = b; out[n++] = c;
+        }
+        out.resize(n);
+    }
+    if (resultError) *resultError = (float)std::sqrt(maxError);
+    return out;
+}
+
+// Appends an LOD chain for every SubMesh at kLodRatios of its triangles. The new index
+// lists go after the existing ones, with their own SubMeshes, and mesh.lods[i] names the
+// SubMeshes of LOD i (LOD 0 is the original). Each level simplifies the one before it.
+// The chain stops early once a level would not remove at least 10% more triangles.
+inline void buildLods(Mesh& mesh) {
+    const size_t stride = ObjLayoutPUN::kFloats;
+    size_t vertexCount = mesh.vertices.size() / stride;
+    uint32_t baseSubmeshes = (uint32_t)mesh.submeshes.size();
+    mesh.lods.assign(1, {0, baseSubmeshes, 0});
+
+    for (float ratio : kLodRatios) {
+        const MeshLod prev = mesh.lods.back();
+        size_t prevIndices = 0;
+        for (uint32_t s = prev.firstSubmesh; s < prev.firstSubmesh + prev.submeshCount; ++s) prevIndices += mesh.submeshes[s].count;
+
+        size_t indexMark = mesh.indices.size(), total = 0;
+        MeshLod lod = {(uint32_t)mesh.submeshes.size(), prev.submeshCount, prev.error};
+        for (uint32_t s = prev.firstSubmesh; s < prev.firstSubmesh + prev.submeshCount; ++s) {
+            SubMesh sm = mesh.submeshes[s];
+            size_t target = (size_t)(mesh.submeshes[s - prev.firstSubmesh].count / 3 * ratio) * 3;
+            float error = 0;
+            std::vector<unsigned int> lodIndices = simplifyMesh(&mesh.indices[sm.firstIndex], sm.count, mesh.vertices.data(), vertexCount, target, &error);
+            sm.firstIndex = (unsigned int)mesh.indices.size();
+            sm.count = (unsigned int)lodIndices.size();
+            mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+            mesh.faceMat.insert(mesh.faceMat.end(), lodIndices.size() / 3, sm.material);
+            mesh.submeshes.push_back(sm);
+            lod.error = std::max(lod.error, error);
+            total += lodIndices.size();
+        }
+        if (total == 0 || total > prevIndices * 9 / 10) {
+            mesh.indices.resize(indexMark);
+            mesh.faceMat.resize(indexMark / 3);
+            mesh.submeshes.resize(lod.firstSubmesh);
+            break;
+        }
+        mesh.lods.push_back(lod);
+    }
+    if (mesh.lods.size() == 1) mesh.lods.clear();
+}
+
+// Coarsest LOD whose error stays under `maxPixelError` pixels on screen, given how many
+// pixels one object-space unit covers at the object's distance.
+inline size_t selectLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError = 1.0f) {
+    size_t lod = 0;
+    for (size_t i = 1; i < lods.size(); ++i)
+        if (lods[i].error * pixelsPerUnit <= maxPixelError) lod = i;
+    return lod;
+}
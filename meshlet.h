@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "loadObjMtl.h"
+
+const size_t kMeshletMaxVertices = 64;
+const size_t kMeshletMaxTriangles = 124;
+
+// Bounding sphere and normal cone of the triangles m covers in `indices`.
+// The cone is left open (axis 0, cutoff 1) when the normals spread too far to ever cull.
+inline void computeMeshletBounds(Meshlet& m, const unsigned int* indices, const float* vertices, size_t stride = ObjLayoutPUN::kFloats) {
+    float bmin[3] = {1e30f, 1e30f, 1e30f}, bmax[3] = {-1e30f, -1e30f, -1e30f};
+    for (uint32_t i = m.firstIndex; i < m.firstIndex + m.count; ++i)
+        for (int k = 0; k < 3; ++k) {
+            float v = vertices[indices[i]*stride + k];
+            bmin[k] = std::min(bmin[k], v);
+            bmax[k] = std::max(bmax[k], v);
+        }
+    float r2 = 0;
+    for (int k = 0; k < 3; ++k) m.center[k] = (bmin[k] + bmax[k]) * 0.5f;
+    for (uint32_t i = m.firstIndex; i < m.firstIndex + m.count; ++i) {
+        const float* p = &vertices[indices[i]*stride];
+        float dx = p[0] - m.center[0], dy = p[1] - m.center[1], dz = p[2] - m.center[2];
+        r2 = std::max(r2, dx*dx + dy*dy + dz*dz);
+    }
+    m.radius = std::sqrt(r2);
+
+    std::vector<float> normals;
+    normals.reserve(m.count);
+    float axis[3] = {0,0,0};
+    for (uint32_t i = m.firstIndex; i + 3 <= m.firstIndex + m.count; i += 3) {
+        const float* a = &vertices[indices[i]*stride];
+        const float* b = &vertices[indices[i+1]*stride];
+        const float* c = &vertices[indices[i+2]*stride];
+        float e1[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]}, e2[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+        float n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+        float len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (len == 0) continue;
+        for (int k = 0; k < 3; ++k) { normals.push_back(n[k] / len); axis[k] += n[k] / len; }
+    }
+    float len = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+    float minDot = 1;
+    for (size_t i = 0; len > 0 && i < normals.size(); i += 3)
+        minDot = std::min(minDot, (normals[i]*axis[0] + normals[i+1]*axis[1] + normals[i+2]*axis[2]) / len);
+    if (len == 0 || minDot <= 0.1f) {
+        m.coneAxis[0] = m.coneAxis[1] = m.coneAxis[2] = 0;
+        m.coneCutoff = 1;
+        return;
+    }
+    for (int k = 0; k < 3; ++k) m.coneAxis[k] = axis[k] / len;
+    m.coneCutoff = std::sqrt(1 - minDot*minDot);
+}
+
+// Cuts every SubMesh into meshlets of at most kMeshletMaxVertices distinct vertices and
+// kMeshletMaxTriangles triangles, taking triangles in their current order. Nothing is
+// reordered, so run it last: after the vertex cache pass consecutive triangles are already
+// neighbours and make tight clusters. Meshlets are stored in submesh order and each one is
+// a range of index positions, so it can be drawn with the submesh's baseVertex.
+inline void buildMeshlets(Mesh& mesh) {
+    const size_t stride = ObjLayoutPUN::kFloats;
+    mesh.meshlets.clear();
+    std::vector<uint32_t> seen(mesh.vertices.size() / stride, ~0u);
+    // distinct vertices of triangle i not yet in meshlet `id`
+    auto fresh = [&](uint32_t i, uint32_t id) {
+        size_t n = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = mesh.indices[i+k];
+            bool repeat = (k > 0 && v == mesh.indices[i]) || (k > 1 && v == mesh.indices[i+1]);
+            n += seen[v] != id && !repeat;
+        }
+        return n;
+    };
+    for (uint32_t s = 0; s < mesh.submeshes.size(); ++s) {
+        const SubMesh& sm = mesh.submeshes[s];
+        size_t vertices = 0;
+        for (uint32_t i = sm.firstIndex; i + 3 <= sm.firstIndex + sm.count; i += 3) {
+            uint32_t id = (uint32_t)mesh.meshlets.size() - 1;
+            bool open = !mesh.meshlets.empty() && mesh.meshlets.back().submesh == s;
+            if (!open || vertices + fresh(i, id) > kMeshletMaxVertices || mesh.meshlets.back().count / 3 >= kMeshletMaxTriangles) {
+                mesh.meshlets.push_back({s, i, 0, {0,0,0}, 0, {0,0,0}, 0}); // bounds come after the loop
+                vertices = 0;
+                id++;
+            }
+            vertices += fresh(i, id);
+            for (int k = 0; k < 3; ++k) seen[mesh.indices[i+k]] = id;
+            mesh.meshlets.back().count += 3;
+        }
+    }
+    for (Meshlet& m : mesh.meshlets) computeMeshletBounds(m, mesh.indices.data(), mesh.vertices.data(), stride);
+}
+
+// True when every triangle of `m` faces away from a perspective eye at `eye` (object
+// space); the sphere keeps it conservative for every point of the cluster.
+inline bool meshletBackfacingFrom(const Meshlet& m, const float eye[3]) {
+    float d[3] = {m.center[0] - eye[0], m.center[1] - eye[1], m.center[2] - eye[2]};
+    float dist = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    return d[0]*m.coneAxis[0] + d[1]*m.coneAxis[1] + d[2]*m.coneAxis[2] >= m.coneCutoff * dist + m.radius;
+}
@@ -3,11 +3,12 @@
 #include <emscripten.h>
 #include <cmath>
 #include <stdio.h>
-#include "loadObj2.h"
+#include "meshIndex16.h"
 
 SDL_Window* window;
 SDL_GLContext glContext;
 Mesh mesh;
+MaterialLib materials;
 GLuint program, vbo, ibo;
 float angle = 0.0f;
 
@@ -51,7 +52,9 @@ bool init() {
     glViewport(0, 0, 640, 480);
     glClearColor(0.1f, 0.9f, 0.1f, 1.0f);
 
-    mesh = loadObjSimple("asserts/cube2.obj");
+    mesh = loadObjMtl<ObjLayoutP>("asserts/cube2.obj", materials, "asserts/");
+    // 16-bit indices work on every WebGL1 device; 32-bit ones need OES_element_index_uint
+    buildIndex16(mesh, ObjLayoutP::kFloats);
     printf("Vertices: %zu, Indices: %zu\n", mesh.vertices.size()/3, mesh.indices.size()/3);
 
     GLuint vsId = compileShader(GL_VERTEX_SHADER, vs);
@@ -67,7 +70,7 @@ bool init() {
 
     glGenBuffers(1, &ibo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size()*sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices16.size()*sizeof(uint16_t), mesh.indices16.data(), GL_STATIC_DRAW);
 
     return true;
 }
@@ -80,10 +83,13 @@ void render() {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     GLint pos = glGetAttribLocation(program, "aPos");
     glEnableVertexAttribArray(pos);
-    glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
+    // WebGL1 has no base-vertex draws, so each range's base vertex goes into the attribute offset
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+    for (const SubMesh& sm : mesh.submeshes) {
+        glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, 0, (void*)((size_t)sm.baseVertex*3*sizeof(float)));
+        glDrawElements(GL_TRIANGLES, sm.count, GL_UNSIGNED_SHORT, (void*)((size_t)sm.firstIndex*sizeof(uint16_t)));
+    }
 
     SDL_GL_SwapWindow(window);
 }
@@ -0,0 +1,158 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+// Locale-independent scanners for the numeric tokens of OBJ records.
+// All of them take [p, end), skip leading blanks, advance p past what they consumed
+// and never read beyond end, so they work on mapped files without a terminator.
+namespace objscan {
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool isDigit(char c) { return (unsigned)(c - '0') < 10; }
+
+inline const char* skipBlank(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+// [+-]digits[.digits][(e|E)[+-]digits]. Up to 19 significant digits are kept, which is
+// exact for anything an exporter writes; the scaling is exact for |exp| <= 22.
+inline bool scanFloat(const char*& p, const char* end, float& out) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* s = skipBlank(p, end);
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = *s++ == '-';
+
+    uint64_t mant = 0;
+    int digits = 0, exp = 0;
+    const char* first = s;
+    for (; s < end && isDigit(*s); ++s) {
+        if (digits < 19) { mant = mant*10 + (*s - '0'); if (mant) ++digits; }
+        else ++exp;
+    }
+    if (s < end && *s == '.') {
+        ++s;
+        for (; s < end && isDigit(*s); ++s) {
+            if (digits < 19) { mant = mant*10 + (*s - '0'); if (mant) ++digits; --exp; }
+        }
+    }
+    if (s == first || (s == first + 1 && *first == '.')) { out = 0; return false; }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool eneg = false;
+        if (e < end && (*e == '-' || *e == '+')) eneg = *e++ == '-';
+        if (e < end && isDigit(*e)) {
+            int ev = 0;
+            for (; e < end && isDigit(*e); ++e) if (ev < 10000) ev = ev*10 + (*e - '0');
+            exp += eneg ? -ev : ev;
+            s = e;
+        }
+    }
+
+    double v = (double)mant;
+    if (mant == 0) v = 0;
+    else if (exp < 0) v = exp >= -22 ? v / pow10[-exp] : v * std::pow(10.0, exp);
+    else if (exp > 0) v = exp <= 22 ? v * pow10[exp] : v * std::pow(10.0, exp);
+    out = (float)(neg ? -v : v);
+    p = s;
+    return true;
+}
+
+inline bool scanInt(const char*& p, const char* end, int& out) {
+    const char* s = p;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = *s++ == '-';
+    if (s >= end || !isDigit(*s)) return false;
+    long long v = 0;
+    for (; s < end && isDigit(*s); ++s) if (v <= INT_MAX) v = v*10 + (*s - '0');
+    if (v > INT_MAX) v = INT_MAX; // no index is that large, so it resolves to -1
+    out = neg ? -(int)v : (int)v;
+    p = s;
+    return true;
+}
+
+// One face corner: "v", "v/t", "v//n" or "v/t/n". Indices are returned as written
+// (1-based, or negative for relative ones); a missing part comes back as 0.
+inline bool scanCorner(const char*& p, const char* end, int& v, int& t, int& n) {
+    const char* s = skipBlank(p, end);
+    t = n = 0;
+    if (!scanInt(s, end, v)) return false;
+    if (s < end && *s == '/') {
+        ++s;
+        scanInt(s, end, t);
+        if (s < end && *s == '/') { ++s; scanInt(s, end, n); }
+    }
+    p = s;
+    return true;
+}
+
+// Turns a raw OBJ index into a 0-based one given how many elements exist so far;
+// 0 (missing) and anything outside those elements map to -1.
+inline int resolveIndex(int raw, size_t count) {
+    long long i = raw > 0 ? raw - 1LL : raw < 0 ? (long long)count + raw : -1;
+    return i >= 0 && (size_t)i < count ? (int)i : -1;
+}
+
+// Start of the line after the one p is on, or end. Looks at 16 bytes per step where
+// SSE2 or wasm simd128 is available.
+inline const char* nextLine(const char* p, const char* end) {
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16)
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), nl))) break;
+#elif defined(__wasm_simd128__)
+    const v128_t nl = wasm_i8x16_splat('\n');
+    for (; end - p >= 16; p += 16)
+        if (wasm_v128_any_true(wasm_i8x16_eq(wasm_v128_load(p), nl))) break;
+#endif
+    while (p < end && *p != '\n') ++p;
+    return p < end ? p + 1 : end;
+}
+
+// Records in a slice of OBJ text, counted the way the parser reads them: `corners` is
+// three per triangle after fan triangulation, `faces` the number of triangles.
+struct RecordCounts {
+    size_t v = 0, vt = 0, vn = 0, corners = 0;
+
+    size_t faces() const { return corners / 3; }
+    RecordCounts& operator+=(const RecordCounts& o) {
+        v += o.v; vt += o.vt; vn += o.vn; corners += o.corners;
+        return *this;
+    }
+};
+
+// Counting prepass for sizing the parse buffers exactly. Only the record type is looked
+// at, except on face lines, whose corners have to be scanned to know how many there are.
+inline RecordCounts countRecords(const char* p, const char* end) {
+    RecordCounts c;
+    while (p < end) {
+        const char* next = nextLine(p, end);
+        const char* eol = next[-1] == '\n' ? next - 1 : next;
+        const char* s = skipBlank(p, eol);
+        const char* t = s;
+        while (t < eol && !isBlank(*t)) ++t;
+        if (t - s == 1 && *s == 'v') ++c.v;
+        else if (t - s == 2 && s[0] == 'v' && s[1] == 't') ++c.vt;
+        else if (t - s == 2 && s[0] == 'v' && s[1] == 'n') ++c.vn;
+        else if (t - s == 1 && *s == 'f') {
+            size_t corners = 0;
+            for (int v, vt, vn; scanCorner(t, eol, v, vt, vn);) ++corners;
+            if (corners >= 3) c.corners += (corners - 2) * 3;
+        }
+        p = next;
+    }
+    return c;
+}
+
+} // namespace objscan
@@ -0,0 +1,180 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "loadObjMtl.h"
+
+// Push parser for an OBJ that arrives in pieces (a fetch stream, a chunked download), so
+// parsing overlaps the transfer. feed() parses every complete line it has been given and
+// appends the new triangles to mesh(): welded vertices in Layout and indices in file order,
+// with faceMat per triangle. feed() never changes vertices or indices that are already
+// there, so a renderer can upload just what was added since it last looked.
+//
+// finish() parses the last line, generates missing normals, groups the triangles by material
+// and computes the bounds, so its Mesh is the one loadObjMtlBuffer returns for the whole
+// text. That can rewrite everything streamed before, so upload its result again.
+template <class Layout = ObjLayoutPUN>
+class ObjStreamParser {
+public:
+    // `resolve` supplies the mtllib files, see fileResolver.h; opt.threads is ignored.
+    explicit ObjStreamParser(MaterialLib& materials, FileResolver resolve = {}, const ObjLoadOptions& opt = {})
+        : materials(materials), resolve(std::move(resolve)), opt(opt),
+          memory(opt.memory ? opt.memory : std::pmr::get_default_resource()),
+          arrays(memory), unique(0, memory), pending(memory) {}
+
+    void feed(const char* data, size_t size) {
+        const char* end = data + size;
+        if (kLoadStats && opt.stats) opt.stats->bytesRead += size;
+        if (!pending.empty()) {
+            const char* nl = (const char*)memchr(data, '\n', size);
+            if (!nl) { pending.append(data, size); return; }
+            pending.append(data, nl + 1);
+            parse(pending.data(), pending.data() + pending.size());
+            pending.clear();
+            data = nl + 1;
+        }
+        const char* complete = end;
+        while (complete > data && complete[-1] != '\n') --complete;
+        if (complete > data) parse(data, complete);
+        pending.assign(complete, end);
+    }
+    void feed(std::string_view data) { feed(data.data(), data.size()); }
+
+    // The triangles so far. Normals of corners without vn are (0,0,1) until finish().
+    const Mesh& mesh() const { return out; }
+
+    // Box of the positions so far, with a radius that holds all of them.
+    MeshBounds bounds() const {
+        MeshBounds b = box.bounds();
+        float dx = b.max[0] - b.min[0], dy = b.max[1] - b.min[1], dz = b.max[2] - b.min[2];
+        b.radius = 0.5f * std::sqrt(dx*dx + dy*dy + dz*dz);
+        return b;
+    }
+
+    Mesh finish() {
+        StatClock clock;
+        LoadStats* stats = kLoadStats ? opt.stats : nullptr;
+        if (!pending.empty()) parse(pending.data(), pending.data() + pending.size());
+        pending.clear();
+
+        if constexpr (Layout::kNormal) {
+            if (opt.generateNormals && missingNormals) {
+                size_t fileNormals = arrays.norm.size();
+                addMissingNormals(arrays.pos, arrays.norm, arrays.faceData, opt);
+                if (stats) {
+                    stats->normalsMs += clock.lap();
+                    stats->generatedNormals += (arrays.norm.size() - fileNormals) / 3;
+                }
+                // the corners that got normals weld differently, so start over
+                unique = CornerTable(arrays.faceData.size(), memory);
+                out.vertices.clear();
+                vertexCount = 0;
+                weld(0);
+                if (stats) stats->weldMs += clock.lap();
+            }
+        }
+        if (stats) stats->vertices += vertexCount;
+
+        out.bounds = box.bounds();
+        const float* center = out.bounds.center;
+        float r2 = 0;
+        for (size_t i = 0; i < out.vertices.size(); i += Layout::kFloats) {
+            const float* p = &out.vertices[i];
+            float dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+            r2 = std::max(r2, dx*dx + dy*dy + dz*dz);
+        }
+        out.bounds.radius = std::sqrt(r2);
+        groupByMaterial(out, materials.size(), memory);
+        if (stats) {
+            double ms = clock.lap();
+            stats->groupMs += ms;
+            stats->totalMs += ms;
+        }
+        return std::move(out);
+    }
+
+private:
+    MaterialLib& materials;
+    FileResolver resolve;
+    ObjLoadOptions opt;
+    std::pmr::memory_resource* memory;
+    ObjArrays arrays;      // every record so far, kept for generating normals in finish()
+    objscan::RecordCounts total;
+    CornerTable unique;
+    BoundsAccumulator box;
+    std::pmr::string pending; // the line the last feed() ended in the middle of
+    Mesh out;
+    unsigned int vertexCount = 0;
+    size_t missingNormals = 0; // corners without vn
+    int currentMat = -1;
+
+    // [p, end) holds whole lines; parsed the same way loadObjMtlBuffer parses one slice.
+    void parse(const char* p, const char* end) {
+        LoadStats* stats = kLoadStats ? opt.stats : nullptr;
+        StatClock clock, start;
+        ObjChunk c(memory);
+        c.counts = objscan::countRecords(p, end);
+        c.base = total;
+        total += c.counts;
+        arrays.pos.resize(total.v*3);
+        if constexpr (Layout::kUV) arrays.uv.resize(total.vt*2);
+        if constexpr (Layout::kNormal) arrays.norm.resize(total.vn*3);
+        arrays.faceData.resize(total.corners);
+        if (stats) {
+            stats->countMs += clock.lap();
+            stats->positions += c.counts.v; stats->texcoords += c.counts.vt; stats->normals += c.counts.vn;
+            stats->triangles += c.counts.faces(); stats->corners += c.counts.corners;
+        }
+        parseObjChunk<Layout>(p, end, c, arrays);
+        box.add(c.bounds);
+        double mtlMs = applyObjEvents(c, materials, resolve, currentMat, out.faceMat, stats);
+        size_t dropped = dropInvalidTriangles(arrays.faceData, out.faceMat, c.base.corners);
+        total.corners -= dropped * 3;
+        if (stats) stats->triangles -= dropped;
+        if (stats) {
+            stats->mtlMs += mtlMs;
+            stats->parseMs += clock.lap() - mtlMs;
+        }
+        weld(c.base.corners);
+        if (stats) {
+            stats->weldMs += clock.lap();
+            stats->totalMs += start.lap();
+        }
+    }
+
+    // Welds the corners from `first` on and writes each new vertex as it is found, which
+    // hands out the same ids as loadObjMtlBuffer.
+    void weld(size_t first) {
+        static const float noUV[2] = {0,0}, noNormal[3] = {0,0,1};
+        size_t corners = arrays.faceData.size();
+        if (CornerTable::capacity(corners) > unique.slots.size()) {
+            // room for twice as many, so regrowing stays linear overall
+            CornerTable bigger(corners * 2, memory);
+            for (size_t i = 0; i < first; ++i) {
+                auto [vi, ti, ni] = attribs(i);
+                bigger.findOrInsert(vi, ti, ni, (int)out.indices[i]);
+            }
+            unique = std::move(bigger);
+        }
+        out.indices.resize(corners);
+        for (size_t i = first; i < corners; ++i) {
+            if constexpr (Layout::kNormal) missingNormals += std::get<2>(arrays.faceData[i]) < 0;
+            auto [vi, ti, ni] = attribs(i);
+            int id = unique.findOrInsert(vi, ti, ni, (int)vertexCount);
+            if (id == (int)vertexCount) {
+                out.vertices.resize(out.vertices.size() + Layout::kFloats);
+                Layout::write(&out.vertices[(size_t)vertexCount * Layout::kFloats], &arrays.pos[vi*3],
+                              ti >= 0 ? &arrays.uv[ti*2] : noUV, ni >= 0 ? &arrays.norm[ni*3] : noNormal);
+                ++vertexCount;
+            }
+            out.indices[i] = id;
+        }
+    }
+
+    std::tuple<int,int,int> attribs(size_t i) const {
+        auto [vi, ti, ni] = arrays.faceData[i];
+        if constexpr (!Layout::kUV) ti = -1;
+        if constexpr (!Layout::kNormal) ni = -1;
+        return std::make_tuple(vi, ti, ni);
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+// Four floats at a time through SSE, wasm simd128 or a scalar fallback, for the normal
+// generator and the loader's bounds.
+namespace simd4 {
+
+#if defined(__SSE2__) || defined(_M_X64)
+struct F4 { __m128 v; };
+inline F4 load4(const float* p) { return {_mm_loadu_ps(p)}; }
+inline void store4(float* p, F4 a) { _mm_storeu_ps(p, a.v); }
+inline F4 splat(float f) { return {_mm_set1_ps(f)}; }
+inline F4 operator+(F4 a, F4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline F4 operator-(F4 a, F4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline F4 operator*(F4 a, F4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline F4 operator/(F4 a, F4 b) { return {_mm_div_ps(a.v, b.v)}; }
+inline F4 sqrt4(F4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline F4 min4(F4 a, F4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline F4 max4(F4 a, F4 b) { return {_mm_max_ps(a.v, b.v)}; }
+// positive ? a : b
+inline F4 selectPositive(F4 x, F4 a, F4 b) {
+    __m128 m = _mm_cmpgt_ps(x.v, _mm_setzero_ps());
+    return {_mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v))};
+}
+#elif defined(__wasm_simd128__)
+struct F4 { v128_t v; };
+inline F4 load4(const float* p) { return {wasm_v128_load(p)}; }
+inline void store4(float* p, F4 a) { wasm_v128_store(p, a.v); }
+inline F4 splat(float f) { return {wasm_f32x4_splat(f)}; }
+inline F4 operator+(F4 a, F4 b) { return {wasm_f32x4_add(a.v, b.v)}; }
+inline F4 operator-(F4 a, F4 b) { return {wasm_f32x4_sub(a.v, b.v)}; }
+inline F4 operator*(F4 a, F4 b) { return {wasm_f32x4_mul(a.v, b.v)}; }
+inline F4 operator/(F4 a, F4 b) { return {wasm_f32x4_div(a.v, b.v)}; }
+inline F4 sqrt4(F4 a) { return {wasm_f32x4_sqrt(a.v)}; }
+// pmin/pmax are a < b ? a : b like minps, unlike f32x4.min which propagates NaN
+inline F4 min4(F4 a, F4 b) { return {wasm_f32x4_pmin(b.v, a.v)}; }
+inline F4 max4(F4 a, F4 b) { return {wasm_f32x4_pmax(b.v, a.v)}; }
+inline F4 selectPositive(F4 x, F4 a, F4 b) {
+    return {wasm_v128_bitselect(a.v, b.v, wasm_f32x4_gt(x.v, wasm_f32x4_splat(0)))};
+}
+#else
+struct F4 { float v[4]; };
+inline F4 load4(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store4(float* p, F4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline F4 splat(float f) { return {{f, f, f, f}}; }
+#define SIMD4_OP(op) \
+    inline F4 operator op(F4 a, F4 b) { F4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] op b.v[i]; return r; }
+SIMD4_OP(+) SIMD4_OP(-) SIMD4_OP(*) SIMD4_OP(/)
+#undef SIMD4_OP
+inline F4 sqrt4(F4 a) { for (float& f : a.v) f = std::sqrt(f); return a; }
+inline F4 min4(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline F4 max4(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline F4 selectPositive(F4 x, F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = x.v[i] > 0 ? a.v[i] : b.v[i]; return a; }
+#endif
+
+} // namespace simd4
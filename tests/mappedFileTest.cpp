@@ -0,0 +1,55 @@
+// MappedFile: opening, moving and empty files.
+//   g++ -O2 -std=c++17 -I.. mappedFileTest.cpp -o mappedFileTest && ./mappedFileTest
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "mappedFile.h"
+
+static int failures = 0;
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); ++failures; } } while (0)
+
+static std::string writeTemp(const char* name, const std::string& contents) {
+    std::string path = std::string("/tmp/") + name;
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(contents.data(), 1, contents.size(), f);
+    fclose(f);
+    return path;
+}
+
+static void checkOpen(const MappedFile& f, const std::string& contents) {
+    CHECK(f);
+    CHECK(f.data != nullptr);
+    CHECK(f.size == contents.size());
+    CHECK(f.data && memcmp(f.data, contents.data(), contents.size()) == 0);
+}
+
+int main() {
+    for (const std::string& contents : {std::string(), std::string("v 1 2 3\nf 1 1 1\n")}) {
+        std::string path = writeTemp("mappedFileTest.obj", contents);
+
+        MappedFile opened(path.c_str());
+        checkOpen(opened, contents);
+
+        MappedFile constructed(std::move(opened));
+        checkOpen(constructed, contents);
+        CHECK(!opened);
+
+        MappedFile assigned;
+        assigned = std::move(constructed);
+        checkOpen(assigned, contents);
+        CHECK(!constructed);
+
+        MappedFile replaced(path.c_str());
+        replaced = std::move(assigned);
+        checkOpen(replaced, contents);
+        remove(path.c_str());
+    }
+
+    MappedFile missing("/tmp/mappedFileTest.missing");
+    CHECK(!missing);
+    CHECK(missing.data == nullptr && missing.size == 0);
+
+    printf(failures ? "mappedFileTest: %d failures\n" : "mappedFileTest: ok\n", failures);
+    return failures != 0;
+}
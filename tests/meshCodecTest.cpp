@@ -0,0 +1,159 @@
+// meshCodec: index and vertex streams decode to exactly what was encoded, also inside a
+// .wglmesh written by writeMeshCache and read back with openMeshCacheBuffer.
+//   g++ -O2 -std=c++17 -I.. meshCodecTest.cpp -o meshCodecTest && ./meshCodecTest
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "mappedFile.h"
+#include "meshCache.h"
+#include "meshCodec.h"
+#include "meshPipeline.h"
+#include "meshQuant.h"
+
+static int failures = 0;
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); ++failures; } } while (0)
+
+template <typename T>
+static void checkIndices(const std::vector<T>& indices) {
+    std::vector<uint8_t> encoded = encodeIndexBuffer(indices.data(), indices.size());
+    std::vector<T> decoded(indices.size());
+    CHECK(decodeIndexBuffer(decoded.data(), decoded.size(), encoded.data(), encoded.size()));
+    CHECK(decoded == indices);
+    if (!encoded.empty()) CHECK(!decodeIndexBuffer(decoded.data(), decoded.size(), encoded.data(), encoded.size() - 1));
+}
+
+static void checkVertices(const void* vertices, size_t count, size_t stride) {
+    std::vector<uint8_t> encoded = encodeVertexBuffer(vertices, count, stride);
+    std::vector<uint8_t> decoded(count * stride);
+    CHECK(decodeVertexBuffer(decoded.data(), count, stride, encoded.data(), encoded.size()));
+    CHECK(count == 0 || memcmp(decoded.data(), vertices, count * stride) == 0);
+    if (!encoded.empty()) CHECK(!decodeVertexBuffer(decoded.data(), count, stride, encoded.data(), encoded.size() - 1));
+}
+
+// A bumpy 60x60 grid with normals and uvs, so the real pipeline has something to optimize.
+static std::string gridObj() {
+    const int n = 60;
+    std::string obj;
+    char line[128];
+    for (int y = 0; y <= n; ++y)
+        for (int x = 0; x <= n; ++x) {
+            snprintf(line, sizeof(line), "v %g %g %g\nvt %g %g\n", x / (float)n, y / (float)n, 0.05f * std::sin(x * 0.3f) * std::cos(y * 0.2f), x / (float)n, y / (float)n);
+            obj += line;
+        }
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\nf %d/%d %d/%d %d/%d\n", a, a, b, b, d, d, a, a, d, d, c, c);
+            obj += line;
+        }
+    return obj;
+}
+
+static void checkMesh(Mesh mesh) {
+    prepareMesh(mesh);
+    checkIndices(mesh.indices);
+    checkIndices(mesh.indices16);
+    checkVertices(mesh.vertices.data(), mesh.vertices.size() / ObjLayoutPUN::kFloats, ObjLayoutPUN::kFloats * sizeof(float));
+    QuantizedVertices q = quantizeVertices(mesh);
+    checkVertices(q.data.data(), q.data.size() / q.format.stride, q.format.stride);
+}
+
+// Writes `mesh` as a cache file in every vertex/compression combination, reads the file's
+// bytes back from memory and compares everything the cache holds with the source.
+static void checkCache(Mesh mesh, const MaterialLib& materials) {
+    PrepareOptions prep;
+    prep.lods = true;
+    prepareMesh(mesh, prep);
+    QuantizedVertices q = quantizeVertices(mesh);
+    const char* path = "meshCodecTest.wglmesh";
+    for (int quantize = 0; quantize < 2; ++quantize)
+        for (int compress = 0; compress < 2; ++compress) {
+            CHECK(writeMeshCache(path, mesh, materials, 42, quantize ? &q : nullptr, compress));
+            std::vector<char> bytes;
+            {
+                MappedFile file(path);
+                CHECK(file);
+                if (file) bytes.assign(file.data, file.data + file.size);
+            }
+            remove(path);
+            MeshCache cache;
+            MaterialLib read;
+            CHECK(!openMeshCacheBuffer(cache, bytes.data(), bytes.size(), read, 43));
+            CHECK(!openMeshCacheBuffer(cache, bytes.data(), bytes.size() / 2, read, 42));
+            if (!openMeshCacheBuffer(cache, bytes.data(), bytes.size(), read, 42)) {
+                CHECK(!"openMeshCacheBuffer failed");
+                continue;
+            }
+            bytes.assign(bytes.size(), 0); // the cache must not point into the buffer
+
+            size_t vertexCount = mesh.vertices.size() / ObjLayoutPUN::kFloats;
+            const void* vertices = quantize ? (const void*)q.data.data() : mesh.vertices.data();
+            size_t stride = quantize ? q.format.stride : ObjLayoutPUN::kFloats * sizeof(float);
+            bool narrow = mesh.indices16.size() == mesh.indices.size();
+            CHECK(cache.vertexCount == vertexCount && cache.format.stride == stride);
+            CHECK(memcmp(cache.vertices, vertices, vertexCount * stride) == 0);
+            CHECK(cache.indexCount == mesh.indices.size() && cache.indexSize == (narrow ? 2u : 4u));
+            CHECK(memcmp(cache.indices, narrow ? (const void*)mesh.indices16.data() : mesh.indices.data(), mesh.indices.size() * cache.indexSize) == 0);
+            CHECK(memcmp(&cache.bounds, &mesh.bounds, sizeof(MeshBounds)) == 0);
+            CHECK(cache.submeshes.size() == mesh.submeshes.size());
+            for (size_t i = 0; i < cache.submeshes.size() && i < mesh.submeshes.size(); ++i) {
+                const SubMesh &a = cache.submeshes[i], &b = mesh.submeshes[i];
+                CHECK(a.material == b.material && a.firstIndex == b.firstIndex && a.count == b.count && a.baseVertex == b.baseVertex);
+            }
+            CHECK(cache.meshlets.size() == mesh.meshlets.size() &&
+                  (mesh.meshlets.empty() || memcmp(cache.meshlets.data(), mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet)) == 0));
+            CHECK(cache.lods.size() == mesh.lods.size() &&
+                  (mesh.lods.empty() || memcmp(cache.lods.data(), mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod)) == 0));
+            CHECK(read.size() == materials.size());
+            for (size_t i = 0; i < read.size() && i < materials.size(); ++i)
+                CHECK(read.list[i].name == materials.list[i].name && read.list[i].texPath == materials.list[i].texPath &&
+                      memcmp(read.list[i].kd, materials.list[i].kd, sizeof(materials.list[i].kd)) == 0);
+        }
+}
+
+int main() {
+    std::mt19937 rng(1234);
+
+    // deltas that overflow int32 both ways, around every varint length
+    checkIndices(std::vector<uint32_t>{0, 0xFFFFFFFFu, 0, 0x80000000u, 0x7FFFFFFFu, 0x80000000u, 1, 0xFFFFFFFEu, 0x7F, 0x80, 0x3FFF, 0x4000, 0});
+    checkIndices(std::vector<uint16_t>{0, 0xFFFF, 0, 0x8000, 0x7FFF, 1, 0xFFFE});
+    checkIndices(std::vector<uint32_t>{});
+    for (int round = 0; round < 20; ++round) {
+        std::vector<uint32_t> wide(1 + rng() % 3000);
+        std::vector<uint16_t> narrow(wide.size());
+        for (size_t i = 0; i < wide.size(); ++i) {
+            wide[i] = round % 2 ? (uint32_t)rng() : (uint32_t)(i + rng() % 64);
+            narrow[i] = (uint16_t)wide[i];
+        }
+        checkIndices(wide);
+        checkIndices(narrow);
+    }
+
+    // block and group tails, strides that are not a multiple of 4, and every delta width
+    for (size_t stride : {1, 3, 12, 32}) {
+        for (size_t count : {0, 1, 15, 16, 17, 255, 256, 257, 1000}) {
+            std::vector<uint8_t> noise(count * stride), smooth(count * stride, 0);
+            for (uint8_t& b : noise) b = (uint8_t)rng();
+            for (size_t i = 0; i < smooth.size(); ++i) smooth[i] = (uint8_t)(i / stride * (i % stride) / 4 + rng() % 3);
+            checkVertices(noise.data(), count, stride);
+            checkVertices(smooth.data(), count, stride);
+        }
+    }
+
+    MaterialLib materials;
+    std::string grid = gridObj();
+    checkMesh(loadObjMtlBuffer(grid, materials, fileResolver("")));
+    checkMesh(loadObjMtl("../asserts/cube.obj", materials, "../asserts/"));
+
+    MaterialLib gridMaterials, cubeMaterials;
+    checkCache(loadObjMtlBuffer(grid, gridMaterials, fileResolver("")), gridMaterials);
+    Mesh cube = loadObjMtl("../asserts/cube.obj", cubeMaterials, "../asserts/");
+    CHECK(cubeMaterials.size() > 0);
+    checkCache(std::move(cube), cubeMaterials);
+
+    printf(failures ? "meshCodecTest: %d failures\n" : "meshCodecTest: ok\n", failures);
+    return failures != 0;
+}
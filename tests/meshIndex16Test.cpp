@@ -0,0 +1,100 @@
+// buildIndex16 on a single-material mesh too big for 16-bit indices, with LODs: every
+// SubMesh of every LOD draws the same triangles through indices16 + baseVertex as through
+// indices, and LOD 0 keeps every triangle's vertices in place.
+//   g++ -O2 -std=c++17 -pthread -I.. meshIndex16Test.cpp -o meshIndex16Test && ./meshIndex16Test
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "meshIndex16.h"
+#include "meshSimplify.h"
+
+static int failures = 0;
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); ++failures; } } while (0)
+
+const size_t kStride = ObjLayoutPUN::kFloats;
+using Triangle = std::array<float, 3 * kStride>;
+
+// A bumpy n x n grid with uvs, (n + 1)^2 vertices under one material.
+static std::string gridObj(int n) {
+    std::string obj = "mtllib grid.mtl\nusemtl grey\n";
+    char line[128];
+    for (int y = 0; y <= n; ++y)
+        for (int x = 0; x <= n; ++x) {
+            snprintf(line, sizeof(line), "v %g %g %g\nvt %g %g\n", x / (float)n, y / (float)n, 0.05f * std::sin(x * 0.3f) * std::cos(y * 0.2f), x / (float)n, y / (float)n);
+            obj += line;
+        }
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\nf %d/%d %d/%d %d/%d\n", a, a, b, b, d, d, a, a, d, d, c, c);
+            obj += line;
+        }
+    return obj;
+}
+
+// The vertex data of the triangles in indices [first, first + count).
+static std::vector<Triangle> triangles(const Mesh& mesh, size_t first, size_t count) {
+    std::vector<Triangle> out(count / 3);
+    for (size_t t = 0; t < out.size(); ++t)
+        for (size_t k = 0; k < 3; ++k) {
+            const float* v = &mesh.vertices[mesh.indices[first + 3*t + k] * kStride];
+            std::copy(v, v + kStride, out[t].begin() + k * kStride);
+        }
+    return out;
+}
+
+// Every LOD's triangles, in LOD order.
+static std::vector<std::vector<Triangle>> lodTriangles(const Mesh& mesh) {
+    std::vector<std::vector<Triangle>> out;
+    for (const MeshLod& lod : mesh.lods) {
+        out.emplace_back();
+        for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; ++s) {
+            std::vector<Triangle> part = triangles(mesh, mesh.submeshes[s].firstIndex, mesh.submeshes[s].count);
+            out.back().insert(out.back().end(), part.begin(), part.end());
+        }
+    }
+    return out;
+}
+
+int main() {
+    MaterialLib materials;
+    std::string obj = gridObj(270);
+    Mesh mesh = loadObjMtlBuffer(obj, materials, memoryResolver({{"grid.mtl", "newmtl grey\nKd 0.5 0.5 0.5\n"}}));
+    CHECK(mesh.vertices.size() / kStride > kMaxVertices16);
+    CHECK(mesh.submeshes.size() == 1);
+    buildLods(mesh);
+    CHECK(mesh.lods.size() > 1);
+
+    std::vector<std::vector<Triangle>> before = lodTriangles(mesh);
+    buildIndex16(mesh);
+    std::vector<std::vector<Triangle>> after = lodTriangles(mesh);
+    size_t vertexCount = mesh.vertices.size() / kStride;
+
+    CHECK(mesh.lods[0].submeshCount > 1); // LOD 0 had to be split
+    CHECK(mesh.indices16.size() == mesh.indices.size());
+    for (const MeshLod& lod : mesh.lods)
+        for (uint32_t s = lod.firstSubmesh; s < lod.firstSubmesh + lod.submeshCount; ++s) {
+            const SubMesh& sm = mesh.submeshes[s];
+            CHECK(sm.material == 0);
+            bool same = true;
+            for (size_t k = sm.firstIndex; k < sm.firstIndex + sm.count; ++k)
+                same = same && mesh.indices[k] == sm.baseVertex + mesh.indices16[k] && mesh.indices[k] < vertexCount;
+            if (!same) printf("submesh %u: indices16 + baseVertex differs from indices\n", s);
+            CHECK(same);
+        }
+
+    // LOD 0 keeps its triangles in place; coarser LODs may regroup theirs.
+    CHECK(before.size() == after.size());
+    CHECK(!before.empty() && before[0] == after[0]);
+    for (size_t i = 1; i < before.size() && i < after.size(); ++i) {
+        std::sort(before[i].begin(), before[i].end());
+        std::sort(after[i].begin(), after[i].end());
+        CHECK(before[i] == after[i]);
+    }
+
+    printf(failures ? "meshIndex16Test: %d failures\n" : "meshIndex16Test: ok\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,89 @@
+// ObjStreamParser: any split of the text gives the mesh loadObjMtlBuffer gives for all of it.
+//   g++ -O2 -std=c++17 -pthread -I.. objStreamTest.cpp -o objStreamTest && ./objStreamTest
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "mappedFile.h"
+#include "objStream.h"
+
+static int failures = 0;
+#define CHECK(x) do { if (!(x)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); ++failures; } } while (0)
+
+const char* kMtl = "newmtl red\nKd 1 0 0\nnewmtl blue\nKd 0 0 1\nmap_Kd blue.png\n";
+
+// Materials switching mid-file, quads and a pentagon, relative indices, corners with and
+// without vt/vn, CRLF lines, a face with an index out of range and no final newline.
+static std::string mixedObj() {
+    std::string obj = "# mixed\nmtllib mixed.mtl\n";
+    char line[160];
+    for (int y = 0; y <= 12; ++y)
+        for (int x = 0; x <= 12; ++x) {
+            snprintf(line, sizeof(line), "v %g %g %g\nvt %g %g\n", x * 0.1f, y * 0.1f, 0.02f * std::sin(x * 0.7f + y), x / 12.0f, y / 12.0f);
+            obj += line;
+        }
+    obj += "vn 0 0 1\r\nvn 0 1 0\r\n";
+    for (int y = 0; y < 12; ++y)
+        for (int x = 0; x < 12; ++x) {
+            int a = y * 13 + x + 1, b = a + 1, c = a + 14, d = a + 13;
+            if (x == 0) obj += y % 3 == 0 ? "usemtl red\n" : y % 3 == 1 ? "usemtl blue\n" : "usemtl\n";
+            if ((x + y) % 4 == 0) snprintf(line, sizeof(line), "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, b, b, c, c, d, d);
+            else if ((x + y) % 4 == 1) snprintf(line, sizeof(line), "f %d %d %d\r\nf %d %d %d\r\n", a, b, c, a, c, d);
+            else if ((x + y) % 4 == 2) snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n", a, a, b, b, c, c, d, d);
+            else snprintf(line, sizeof(line), "f %d//2 %d//2 %d//2\n", a, b, c);
+            obj += line;
+        }
+    obj += "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0.5 1.5 1\nv 0 1 1\nf -5 -4 -3 -2 -1\nf 1 2 999\nf -1 -2 -3";
+    return obj;
+}
+
+template <class Layout>
+static void checkSplits(const char* name, std::string_view obj, const FileResolver& resolve) {
+    MaterialLib wholeMaterials;
+    Mesh whole = loadObjMtlBuffer<Layout>(obj, wholeMaterials, resolve);
+    CHECK(!whole.indices.empty());
+
+    for (size_t chunk : {(size_t)1, (size_t)7, (size_t)4093, obj.size()}) {
+        MaterialLib materials;
+        ObjStreamParser<Layout> parser(materials, resolve);
+        size_t vertices = 0, indices = 0;
+        bool grows = true;
+        for (size_t at = 0; at < obj.size(); at += chunk) {
+            parser.feed(obj.substr(at, chunk));
+            // feed() only appends
+            grows = grows && parser.mesh().vertices.size() >= vertices && parser.mesh().indices.size() >= indices;
+            vertices = parser.mesh().vertices.size();
+            indices = parser.mesh().indices.size();
+        }
+        Mesh streamed = parser.finish();
+
+        bool same = grows && streamed.vertices == whole.vertices && streamed.indices == whole.indices && streamed.faceMat == whole.faceMat &&
+                    streamed.submeshes.size() == whole.submeshes.size() && materials.size() == wholeMaterials.size() &&
+                    memcmp(&streamed.bounds, &whole.bounds, sizeof(MeshBounds)) == 0;
+        for (size_t i = 0; same && i < whole.submeshes.size(); ++i)
+            same = streamed.submeshes[i].material == whole.submeshes[i].material && streamed.submeshes[i].firstIndex == whole.submeshes[i].firstIndex &&
+                   streamed.submeshes[i].count == whole.submeshes[i].count;
+        for (size_t i = 0; same && i < wholeMaterials.size(); ++i)
+            same = materials.list[i].name == wholeMaterials.list[i].name && materials.list[i].texPath == wholeMaterials.list[i].texPath;
+        if (!same) printf("%s: %zu floats per vertex, %zu byte chunks differ\n", name, Layout::kFloats, chunk);
+        CHECK(same);
+    }
+}
+
+template <class Layout>
+static void checkLayout() {
+    std::string obj = mixedObj();
+    checkSplits<Layout>("mixed", obj, memoryResolver({{"mixed.mtl", kMtl}}));
+    MappedFile cube("../asserts/cube.obj");
+    CHECK(cube);
+    if (cube) checkSplits<Layout>("cube.obj", std::string_view(cube.data, cube.size), fileResolver("../asserts/"));
+}
+
+int main() {
+    checkLayout<ObjLayoutPUN>();
+    checkLayout<ObjLayoutPN>();
+    checkLayout<ObjLayoutP>();
+
+    printf(failures ? "objStreamTest: %d failures\n" : "objStreamTest: ok\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <GLES2/gl2.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "contentHash.h"
+#include "fileResolver.h"
+#include "stb_image.h"
+
+inline GLuint createTexture(int w, int h, const unsigned char* rgba) {
+    GLuint id;
+    glGenTextures(1,&id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,w,h,0,GL_RGBA,GL_UNSIGNED_BYTE,rgba);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    return id;
+}
+
+// `path` with '\' as '/', empty and "." parts dropped and "dir/.." folded, so the spellings
+// of one file in different MTLs compare equal.
+inline std::string canonicalPath(std::string_view path) {
+    std::vector<std::string_view> parts;
+    std::string slashed(path);
+    for (char& c : slashed) if (c == '\\') c = '/';
+    std::string_view rest = slashed;
+    bool absolute = !rest.empty() && rest[0] == '/';
+    while (!rest.empty()) {
+        size_t cut = rest.find('/');
+        std::string_view part = rest.substr(0, cut);
+        rest = cut == std::string_view::npos ? std::string_view() : rest.substr(cut + 1);
+        if (part.empty() || part == ".") continue;
+        if (part == ".." && !parts.empty() && parts.back() != "..") parts.pop_back();
+        else if (part != ".." || !absolute) parts.push_back(part);
+    }
+    std::string out = absolute ? "/" : "";
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i) out += '/';
+        out += parts[i];
+    }
+    return out;
+}
+
+// GL textures shared between every material that uses the same image. A texture is found by
+// the canonical path its resolver found it at first; an image reached through a new path is
+// still only decoded and uploaded once if its bytes equal one already loaded. Every acquire()
+// that returns a texture is paired with a release(), and the last release deletes it. GL
+// calls need the context, so release or clear() everything before it goes away; the
+// destructor deletes nothing.
+class TextureCache {
+public:
+    struct Stats {
+        size_t decodes = 0;     // images decoded and uploaded
+        size_t pathHits = 0;    // acquires answered by the path
+        size_t contentHits = 0; // acquires of a new path whose bytes were already loaded
+        size_t gpuBytes = 0;    // RGBA bytes of the live textures
+    };
+
+    TextureCache() = default;
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // The texture for `name` as a material writes it, read through `resolve`.
+    // Returns 0 when the image cannot be read or decoded.
+    GLuint acquire(const FileResolver& resolve, std::string_view name) {
+        ResolvedFile file = resolve(name);
+        if (!file) {
+            printf("Failed to load texture: %.*s\n", (int)name.size(), name.data());
+            return 0;
+        }
+        std::string path = canonicalPath(file.path);
+        auto known = byPath.find(path);
+        if (known != byPath.end()) {
+            ++entries[known->second].refs;
+            ++counts.pathHits;
+            return known->second;
+        }
+        uint64_t hash = contentHash(file.data, file.size);
+        auto same = byHash.find(hash);
+        if (same != byHash.end() && entries[same->second].source.size == file.size &&
+            memcmp(entries[same->second].source.data, file.data, file.size) == 0) {
+            Entry& e = entries[same->second];
+            ++e.refs;
+            e.paths.push_back(path);
+            byPath[path] = same->second;
+            ++counts.contentHits;
+            return same->second;
+        }
+        int w, h, comp;
+        unsigned char* rgba = stbi_load_from_memory((const stbi_uc*)file.data, (int)file.size, &w, &h, &comp, 4);
+        if (!rgba) {
+            printf("Failed to decode texture: %s\n", path.c_str());
+            return 0;
+        }
+        GLuint tex = createTexture(w, h, rgba);
+        stbi_image_free(rgba);
+        size_t bytes = (size_t)w * h * 4;
+        if (!file.owner) {
+            // keep the encoded bytes for comparing later hash hits
+            auto copy = std::make_shared<std::string>(file.data, file.size);
+            file.data = copy->data();
+            file.owner = copy;
+        }
+        entries[tex] = Entry{1, hash, bytes, {path}, std::move(file)};
+        byPath[path] = tex;
+        if (same == byHash.end()) byHash[hash] = tex;
+        ++counts.decodes;
+        counts.gpuBytes += bytes;
+        return tex;
+    }
+
+    void release(GLuint tex) {
+        auto it = entries.find(tex);
+        if (it == entries.end() || --it->second.refs > 0) return;
+        for (const std::string& path : it->second.paths) byPath.erase(path);
+        auto hashed = byHash.find(it->second.hash);
+        if (hashed != byHash.end() && hashed->second == tex) byHash.erase(hashed);
+        counts.gpuBytes -= it->second.bytes;
+        glDeleteTextures(1, &tex);
+        entries.erase(it);
+    }
+
+    // Deletes every texture, referenced or not.
+    void clear() {
+        for (auto& [tex, e] : entries) glDeleteTextures(1, &tex);
+        entries.clear();
+        byPath.clear();
+        byHash.clear();
+        counts.gpuBytes = 0;
+    }
+
+    const Stats& stats() const { return counts; }
+
+private:
+    struct Entry {
+        int refs;
+        uint64_t hash;
+        size_t bytes;
+        std::vector<std::string> paths; // every canonical path that led here
+        ResolvedFile source;            // the encoded bytes, for comparing on a hash hit
+    };
+    std::unordered_map<GLuint, Entry> entries;
+    std::unordered_map<std::string, GLuint> byPath;
+    std::unordered_map<uint64_t, GLuint> byHash;
+    Stats counts;
+};
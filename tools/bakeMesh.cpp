@@ -0,0 +1,73 @@
+// Native tool that writes the .wglmesh cache for an OBJ ahead of time, so the
+// preloaded web build never has to parse text at startup.
+//   g++ -O2 -std=c++17 -pthread -I.. bakeMesh.cpp -o bakeMesh   (add -DWGL_LOAD_STATS=1 for phase timings)
+//   ./bakeMesh asserts/cube.obj asserts/ asserts/cube.wglmesh [--quantize] [--compress] [--lods] [--crease degrees]
+// The options must match what the app passes to loadMeshCached, or the hash won't match.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "meshCache.h"
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        printf("usage: %s model.obj baseDir/ out.wglmesh [--quantize] [--compress] [--lods] [--crease degrees]\n", argv[0]);
+        return 1;
+    }
+    MappedFile obj(argv[1]);
+    if (!obj) {
+        printf("Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    PrepareOptions prep;
+    ObjLoadOptions load;
+    load.normals.creaseAngle = kDefaultCreaseAngle;
+    for (int i = 4; i < argc; ++i) {
+        if (strcmp(argv[i], "--quantize") == 0) prep.quantize = true;
+        else if (strcmp(argv[i], "--compress") == 0) prep.compress = true;
+        else if (strcmp(argv[i], "--lods") == 0) prep.lods = true;
+        else if (strcmp(argv[i], "--crease") == 0 && i + 1 < argc) load.normals.creaseAngle = (float)atof(argv[++i]);
+    }
+    MaterialLib materials;
+    ArenaStats arena;
+    LoadStats stats;
+    load.arenaStats = &arena;
+    load.stats = &stats;
+    Mesh mesh = loadObjMtlBuffer(obj.data, obj.size, materials, argv[2], load);
+    VertexCacheStats cacheBefore = analyzeVertexCache(mesh);
+    VertexFetchStats fetchBefore = analyzeVertexFetch(mesh);
+    OverdrawStats overdrawBefore = analyzeOverdraw(mesh);
+    prepareMesh(mesh, prep);
+    VertexCacheStats cacheAfter = analyzeVertexCache(mesh);
+    VertexFetchStats fetchAfter = analyzeVertexFetch(mesh);
+    OverdrawStats overdrawAfter = analyzeOverdraw(mesh);
+    QuantizedVertices quantized;
+    if (prep.quantize) quantized = quantizeVertices(mesh);
+    if (!writeMeshCache(argv[3], mesh, materials, objSourceHash(obj.data, obj.size, argv[2], prep, load), prep.quantize ? &quantized : nullptr, prep.compress)) {
+        printf("Failed to write %s\n", argv[3]);
+        return 1;
+    }
+    MappedFile baked(argv[3]);
+    printf("%s: %zu verts, %zu indices (%s), %zu submeshes, %zu materials, %zu bytes (OBJ %zu)\n", argv[3], mesh.vertices.size()/8, mesh.indices.size(),
+           mesh.indices16.size() == mesh.indices.size() ? "16-bit" : "32-bit", mesh.submeshes.size(), materials.size(), baked.size, obj.size);
+    printf("  vertex cache (FIFO 16): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr);
+    printf("  vertex fetch: overfetch %.3f -> %.3f\n", fetchBefore.overfetch, fetchAfter.overfetch);
+    printf("  overdraw (6 axis views): %.3f -> %.3f\n", overdrawBefore.overdraw, overdrawAfter.overdraw);
+    if (kLoadStats) printLoadStats(stats);
+    printf("  loader arena: %zu bytes in %zu allocations (%zu reserved)\n", arena.requested, arena.allocations, arena.reserved);
+    printf("  bounds: (%g %g %g) - (%g %g %g), sphere radius %g\n", mesh.bounds.min[0], mesh.bounds.min[1], mesh.bounds.min[2],
+           mesh.bounds.max[0], mesh.bounds.max[1], mesh.bounds.max[2], mesh.bounds.radius);
+    for (size_t l = 1; l < mesh.lods.size(); ++l) {
+        size_t count = 0;
+        for (uint32_t s = mesh.lods[l].firstSubmesh; s < mesh.lods[l].firstSubmesh + mesh.lods[l].submeshCount; ++s) count += mesh.submeshes[s].count;
+        printf("  lod %zu: %zu triangles (%.1f%%), error %g\n", l, count/3, 100.0 * count / baseIndexCount(mesh), mesh.lods[l].error);
+    }
+    if (prep.quantize) {
+        const MeshBounds& b = mesh.bounds;
+        float extent = std::max({b.max[0]-b.min[0], b.max[1]-b.min[1], b.max[2]-b.min[2]});
+        printf("  quantized: %u bytes/vertex (was 32), position error %g (%.4f%% of extent), normal error %.2f deg, uv error %g\n",
+               quantized.format.stride, quantized.error.position, extent > 0 ? 100 * quantized.error.position / extent : 0,
+               quantized.error.normalDeg, quantized.error.uv);
+    }
+    return 0;
+}